@@ -8,4 +8,13 @@ cmake --build build --config Release
 if [ -f build/Release/Ark ]; then
     mv build/Release/Ark build/Ark
 fi
-build/Ark tests/unittests.ark --lib lib/ || exit 1
\ No newline at end of file
+build/Ark tests/unittests.ark --lib lib/ || exit 1
+build/Ark tests/unittests.ark --lib lib/ -fgc || exit 1
+
+# the collector must free the scopes only kept alive by reference cycles
+build/Ark tests/gc/closure-cycles.ark -fgc --gc-stats | grep -qE "[1-9][0-9]* freed scopes" || exit 1
+
+# these ones must fail, with the error given next to them
+for test in tests/errors/*.ark; do
+    build/Ark ${test} --lib lib/ 2>&1 | grep -qF "$(cat ${test%.ark}.expected)" || exit 1
+done
@@ -38,6 +38,19 @@ static void Fibo_28_ark(benchmark::State& state)
     }
 }
 
+// the same VM runs the program again and again, as a host running many scripts would do
+static void Fibo_28_ark_reused(benchmark::State& state)
+{
+    Ark::State ark_state;
+    ark_state.doFile("examples/fibo.ark");
+    Ark::VM vm(&ark_state);
+    while (state.KeepRunning())
+    {
+        vm.reset();
+        vm.run();
+    }
+}
+
 static void List_Alloc(benchmark::State& state)
 {
     Ark::State ark_state;
@@ -67,11 +80,82 @@ static void vm_boot(benchmark::State& state)
     }
 }
 
+static void vm_reset(benchmark::State& state)
+{
+    Ark::State ark_state;
+    ark_state.doFile("examples/__arkscript_cache__/fibo.arkc");
+    Ark::VM vm(&ark_state);
+    while (state.KeepRunning())
+    {
+        vm.reset();
+    }
+}
+
+// a host calling the same script function again and again, eg once per request
+static void call_by_name(benchmark::State& state)
+{
+    Ark::State ark_state;
+    ark_state.doString("(let handler (fun (a b) (+ a b)))");
+    Ark::VM vm(&ark_state);
+    vm.run();
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(vm.call("handler", 1, 2));
+    }
+}
+
+static void call_function_handle(benchmark::State& state)
+{
+    Ark::State ark_state;
+    ark_state.doString("(let handler (fun (a b) (+ a b)))");
+    Ark::VM vm(&ark_state);
+    vm.run();
+    auto handler = vm.function("handler");
+    while (state.KeepRunning())
+    {
+        benchmark::DoNotOptimize(handler(1, 2));
+    }
+}
+
+// a plugin calling back a script function given to it, eg an event handler
+static void plugin_resolve(benchmark::State& state)
+{
+    Ark::State ark_state;
+    ark_state.loadFunction("callMany", [&state](std::vector<Ark::Value>& n) {
+        while (state.KeepRunning())
+            benchmark::DoNotOptimize(n[0].resolve(1, 2));
+        return Ark::Nil;
+    });
+    ark_state.doString("(callMany (fun (a b) (+ a b)))");
+    Ark::VM vm(&ark_state);
+    vm.run();
+}
+
+static void plugin_callback(benchmark::State& state)
+{
+    Ark::State ark_state;
+    ark_state.loadFunction("callMany", [&state](std::vector<Ark::Value>& n) {
+        Ark::Callback callback(n[0]);
+        while (state.KeepRunning())
+            benchmark::DoNotOptimize(callback(1, 2));
+        return Ark::Nil;
+    });
+    ark_state.doString("(callMany (fun (a b) (+ a b)))");
+    Ark::VM vm(&ark_state);
+    vm.run();
+}
+
 BENCHMARK(Ackermann_3_6_ark)->Unit(benchmark::kMillisecond);
 BENCHMARK(Fibo_28_ark)->Unit(benchmark::kMillisecond);
+BENCHMARK(Fibo_28_ark_reused)->Unit(benchmark::kMillisecond);
 BENCHMARK(List_Alloc)->Unit(benchmark::kMillisecond);
 BENCHMARK(Ackermann_3_6_cpp)->Unit(benchmark::kMillisecond);
 BENCHMARK(vm_boot)->Unit(benchmark::kNanosecond);
+BENCHMARK(vm_reset)->Unit(benchmark::kNanosecond);
+BENCHMARK(call_by_name)->Unit(benchmark::kNanosecond);
+BENCHMARK(call_function_handle)->Unit(benchmark::kNanosecond);
+BENCHMARK(plugin_resolve)->Unit(benchmark::kNanosecond);
+BENCHMARK(plugin_callback)->Unit(benchmark::kNanosecond);
 
 int main(int argc, char** argv)
 {
@@ -0,0 +1,54 @@
+#include <memory>
+#include <thread>
+#include <algorithm>
+
+#include <benchmark/benchmark.h>
+#include <Ark/Ark.hpp>
+
+// the throughput should grow with the number of threads, up to the number of cores. The pool has a VM
+// per core, more threads would only wait for one
+static const int max_threads = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+
+// a single State for all the threads, each one running the program on a VM from the pool
+struct SharedProgram
+{
+    Ark::State state;
+    std::unique_ptr<Ark::VMPool> pool;
+
+    SharedProgram(const std::string& file)
+    {
+        state.doFile(file);
+        pool = std::make_unique<Ark::VMPool>(&state, max_threads);
+    }
+};
+
+static void Fibo_28_ark_pool(benchmark::State& state)
+{
+    static SharedProgram program("examples/fibo.ark");
+    while (state.KeepRunning())
+    {
+        auto vm = program.pool->acquire();
+        vm->run();
+    }
+}
+
+static void Ackermann_3_6_ark_pool(benchmark::State& state)
+{
+    static SharedProgram program("examples/ackermann.ark");
+    while (state.KeepRunning())
+    {
+        auto vm = program.pool->acquire();
+        vm->run();
+    }
+}
+
+BENCHMARK(Fibo_28_ark_pool)->Unit(benchmark::kMillisecond)->ThreadRange(1, max_threads)->UseRealTime();
+BENCHMARK(Ackermann_3_6_ark_pool)->Unit(benchmark::kMillisecond)->ThreadRange(1, max_threads)->UseRealTime();
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    benchmark::RunSpecifiedBenchmarks();
+
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include <Ark/Constants.hpp>
 #include <Ark/Utils.hpp>
 #include <Ark/VM/VM.hpp>
+#include <Ark/VM/VMPool.hpp>
 #include <Ark/Compiler/Compiler.hpp>
 #include <Ark/REPL/Repl.hpp>
 
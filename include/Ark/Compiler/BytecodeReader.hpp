@@ -20,6 +20,8 @@ namespace Ark
         const bytecode_t& bytecode();
 
         unsigned long long timestamp();
+        // major version of the compiler which produced the bytecode, 0 if it isn't bytecode
+        uint16_t majorVersion();
 
         void display();
     
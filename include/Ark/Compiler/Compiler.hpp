@@ -6,6 +6,7 @@
 #include <string>
 #include <cinttypes>
 #include <optional>
+#include <unordered_map>
 
 #include <Ark/Parser/Parser.hpp>
 #include <Ark/Parser/Node.hpp>
@@ -35,6 +36,29 @@ namespace Ark
         std::vector<std::string> m_plugins;
         std::vector<std::vector<internal::Inst>> m_code_pages;
         std::vector<std::vector<internal::Inst>> m_temp_pages;
+        // locals (symbols ids) of each code page, the global page has none
+        std::vector<std::vector<uint16_t>> m_locals;
+        // number of arguments of each code page, 0 for the global page and the quoted code
+        std::vector<uint16_t> m_arities;
+        // slot of a captured variable in the environment of the closures capturing it, when it's
+        // the same in all of them
+        std::unordered_map<std::string, uint16_t> m_field_slots;
+        // code page in which each temporary page will be copied
+        std::vector<std::size_t> m_temp_pages_owner;
+
+        // debug information: source location of the instructions of each code page, an entry being
+        // added each time the location changes, and name of the variable each page was bound to
+        struct Location
+        {
+            uint16_t offset;  // in the page, the location is valid until the offset of the next one
+            uint16_t file;
+            uint16_t line;
+            uint16_t col;
+        };
+        std::vector<std::vector<Location>> m_locations;
+        std::vector<std::string> m_page_names;
+        std::vector<std::string> m_files;
+        uint16_t m_current_file;
 
         bytecode_t m_bytecode;
 
@@ -66,7 +90,37 @@ namespace Ark
             return {};
         }
 
-        void _compile(Ark::internal::Node x, int p);
+        inline std::optional<std::size_t> localSlot(const std::string& name, int p)
+        {
+            std::size_t page_id = (p >= 0) ? static_cast<std::size_t>(p) : m_temp_pages_owner[-p - 1];
+            if (page_id == 0)
+                return {};
+
+            auto it = std::find(m_symbols.begin(), m_symbols.end(), name);
+            if (it == m_symbols.end())
+                return {};
+            uint16_t id = static_cast<uint16_t>(std::distance(m_symbols.begin(), it));
+
+            auto slot = std::find(m_locals[page_id].begin(), m_locals[page_id].end(), id);
+            if (slot != m_locals[page_id].end())
+                return std::distance(m_locals[page_id].begin(), slot);
+            return {};
+        }
+
+        // is_terminal: the node is in tail position in its function, its value is the one returned
+        void _compile(Ark::internal::Node x, int p, bool is_terminal=false);
+        void collectLocals(const Ark::internal::Node& x, std::vector<uint16_t>& locals);
+        void collectFieldSlots(const Ark::internal::Node& x);
+        void pushVariableInstruction(internal::Instruction inst, internal::Instruction local_inst, const std::string& name, int p);
+        // the next instructions of the page come from the given node
+        void markLocation(const Ark::internal::Node& x, int p);
+        void nameFunctionPage(const std::string& name, const Ark::internal::Node& value, std::size_t page_id);
+        uint16_t addFile(const std::string& filename);
+        // superinstructions, emitted instead of the sequences they replace when the node matches
+        bool compileIncrement(const std::string& name, const Ark::internal::Node& value, int p);
+        bool compileConditionalJump(const Ark::internal::Node& condition, int p);
+        std::optional<uint8_t> operatorInstruction(const Ark::internal::Node& x);
+        uint16_t maxStackDepth(std::size_t page_id);
         std::size_t addSymbol(const std::string& sym);
         std::size_t addValue(Ark::internal::Node x);
         std::size_t addValue(std::size_t page_id);
@@ -15,6 +15,8 @@ namespace Ark::internal
             FUNC_TYPE = 0x03,
         PLUGIN_TABLE_START = 0x03,
         CODE_SEGMENT_START = 0x04,
+        FUNCTIONS_TABLE_START = 0x05,
+        DEBUG_TABLE_START = 0x06,
 
         FIRST_COMMAND = 0x01,
             LOAD_SYMBOL = 0x01,
@@ -33,7 +35,12 @@ namespace Ark::internal
             DEL = 0x0e,
             SAVE_ENV = 0x0f,
             GET_FIELD = 0x10,
-        LAST_COMMAND = 0x10,
+            LOAD_LOCAL  = 0x11,
+            STORE_LOCAL = 0x12,
+            LET_LOCAL   = 0x13,
+            MUT_LOCAL   = 0x14,
+            TAIL_CALL = 0x15,
+        LAST_COMMAND = 0x15,
 
         // NB: when adding an operator, it must be referenced as well under
         // src/VM/FFI/FFI.cpp, in the operators table
@@ -66,11 +73,41 @@ namespace Ark::internal
             TYPE = 0x37,
             HASFIELD = 0x38,
             NOT = 0x39,
-        LAST_OPERATOR = 0x39,
+            YIELD = 0x3a,
+            RESUME = 0x3b,
+        LAST_OPERATOR = 0x3b,
 
-        LAST_INSTRUCTION = 0x39
+        // fused instructions for the most executed sequences, emitted by the compiler
+        FIRST_SUPERINSTRUCTION = 0x40,
+            // two arguments: a symbol id (or a slot) and a constant id
+            INCREMENT = 0x40,
+            DECREMENT = 0x41,
+            INCREMENT_LOCAL = 0x42,
+            DECREMENT_LOCAL = 0x43,
+            // one argument
+            ADD_CONST = 0x44,
+            SUB_CONST = 0x45,
+            // the order of the comparisons must be the same as the one of the operators GT to EQ
+            GT_JUMP_IF_FALSE  = 0x46,
+            LT_JUMP_IF_FALSE  = 0x47,
+            LE_JUMP_IF_FALSE  = 0x48,
+            GE_JUMP_IF_FALSE  = 0x49,
+            NEQ_JUMP_IF_FALSE = 0x4a,
+            EQ_JUMP_IF_FALSE  = 0x4b,
+            // two arguments: a builtin id and the number of arguments
+            CALL_BUILTIN = 0x4c,
+        LAST_SUPERINSTRUCTION = 0x4c,
+
+        LAST_INSTRUCTION = 0x4c
     };
 
+    // set on the constant id of INCREMENT and INCREMENT_LOCAL when they come from (set a (+ cst a)),
+    // the constant being the first operand of the addition
+    constexpr uint16_t ConstantFirst = 0x8000;
+
+    // name of an instruction, as displayed by the tools
+    const char* instructionName(uint8_t inst);
+
     struct Inst
     {
         uint8_t inst = Instruction::NOP;
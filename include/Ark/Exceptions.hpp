@@ -61,6 +61,17 @@ namespace Ark
     protected:
         std::string m_msg;
     };
+
+    // thrown when a VM is cancelled while running a function for the host or a plugin (call(), resolve()),
+    // up to the run which was cancelled
+    class ExecutionCancelled : public std::exception
+    {
+    public:
+        virtual const char* what() const throw()
+        {
+            return "ExecutionCancelled: the VM was cancelled";
+        }
+    };
 }
 
 #endif
\ No newline at end of file
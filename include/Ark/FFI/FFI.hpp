@@ -9,7 +9,7 @@
 #include <Ark/Exceptions.hpp>
 #include <Ark/Utils.hpp>
 
-#define FFI_Function(name) Value name(std::vector<Value>& n)
+#define FFI_Function(name) Value name(ArgsView n, [[maybe_unused]] ExecutionContext& context)
 
 namespace Ark::internal::FFI
 {
@@ -36,6 +36,8 @@ namespace Ark::internal::FFI
         FFI_Function(sort_);  // sort, 1 argument
         FFI_Function(fill);  // fill, 2 arguments
         FFI_Function(setListAt);  // setListAt, 3 arguments
+        FFI_Function(parallelMap);  // parallelMap, 2 arguments
+        FFI_Function(parallelForEach);  // parallelForEach, 2 arguments
     }
 
     namespace IO
@@ -93,6 +95,12 @@ namespace Ark::internal::FFI
         FFI_Function(asin_);  // arcsin, 1 argument
         FFI_Function(atan_);  // arctan, 1 argument
     }
+
+    namespace Coroutines
+    {
+        FFI_Function(coroutine);  // coroutine, multiple arguments
+        FFI_Function(done);  // done?, 1 argument
+    }
 }
 
 #undef FFI_Function
@@ -1,3 +1,11 @@
+// Coroutines
+
+#define CORO_CREATE_ARITY "coroutine needs at least 1 argument: function, [arguments...]"
+#define CORO_CREATE_TE0 "coroutine: function must be a Function"
+
+#define CORO_DONE_ARITY "done? needs 1 argument: coroutine"
+#define CORO_DONE_TE0 "done?: coroutine must be a Coroutine"
+
 // IO
 
 #define IO_INPUT_TE "input: prompt must be a String"
@@ -63,6 +71,14 @@
 #define LIST_SETAT_TE0 "setListAt: list must be a List"
 #define LIST_SETAT_TE1 "setListAt: index must be a Number"
 
+#define LIST_PMAP_ARITY "parallelMap needs 2 arguments: function, list"
+#define LIST_PMAP_TE0 "parallelMap: function must be a Function"
+#define LIST_PMAP_TE1 "parallelMap: list must be a List"
+
+#define LIST_PFOREACH_ARITY "parallelForEach needs 2 arguments: list, function"
+#define LIST_PFOREACH_TE0 "parallelForEach: list must be a List"
+#define LIST_PFOREACH_TE1 "parallelForEach: function must be a Function"
+
 // Mathmatics
 
 #define MATH_ARITY(name) (name " needs 1 argument: value")
@@ -68,6 +68,10 @@ namespace Ark::internal
         std::size_t line() const;
         std::size_t col() const;
 
+        // only set on the root of the AST of a file, its nodes being in the same file
+        void setFilename(const std::string& filename);
+        const std::string& filename() const;
+
         friend std::ostream& operator<<(std::ostream& os, const Node& N);
         friend inline bool operator==(const Node& A, const Node& B);
 
@@ -77,7 +81,8 @@ namespace Ark::internal
 
         std::vector<Node> m_list;
 
-        std::size_t m_line, m_col;
+        std::size_t m_line = 0, m_col = 0;
+        std::string m_filename;
     };
 
     inline bool operator==(const Node& A, const Node& B)
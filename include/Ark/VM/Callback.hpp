@@ -0,0 +1,43 @@
+#ifndef ark_vm_callback
+#define ark_vm_callback
+
+#include <vector>
+
+#include <Ark/VM/Value.hpp>
+#include <Ark/VM/Scope.hpp>
+
+namespace Ark::internal
+{
+    /*
+        A function given to a plugin, prepared to be called many times (event handlers, comparators...).
+        It is called like with Value::resolve, by the VM running on the current thread, but the scope
+        created for the function is kept and reused by the next call when the function didn't capture
+        it in a closure. The values of the last call stay in it until the next one.
+
+        map() runs a batch of calls without going back to the plugin in between.
+    */
+    class Callback
+    {
+    public:
+        explicit Callback(const Value& function);
+
+        template <typename... Args>
+        Value operator()(Args&&... args);
+
+        // call the function once with each argument, and give back the results in the same order
+        std::vector<Value> map(const std::vector<Value>& args);
+
+        inline const Value& function() const
+        {
+            return m_function;
+        }
+
+        template <bool D> friend class Ark::VM_t;
+
+    private:
+        Value m_function;
+        Scope_t m_scope;  // scope of the last call, reused if nothing else holds it
+    };
+}
+
+#endif
@@ -9,9 +9,9 @@
 
 namespace Ark::internal
 {
-    class Value;
+    class Scope;
 
-    using Scope_t = std::shared_ptr<std::vector<Value>>;
+    using Scope_t = std::shared_ptr<Scope>;
 
     class Closure
     {
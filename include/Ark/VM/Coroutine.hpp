@@ -0,0 +1,73 @@
+#ifndef ark_vm_coroutine
+#define ark_vm_coroutine
+
+#include <vector>
+#include <iostream>
+#include <cinttypes>
+
+#include <Ark/VM/Value.hpp>
+#include <Ark/VM/Frame.hpp>
+#include <Ark/VM/Closure.hpp>
+
+namespace Ark::internal
+{
+    /*
+        A function which can suspend itself with `yield' and be resumed later, from where it stopped.
+        While suspended, the coroutine holds what it had in the VM: its frames, the values it left on
+        the stack and its scopes. The VM moves them back on top of the ones of the caller each time
+        the coroutine is resumed, and takes them again when it yields.
+
+        Coroutines are shared between the copies of a value, they are not copied on write.
+    */
+    class Coroutine
+    {
+    public:
+        enum class Status { Created, Suspended, Running, Done };
+
+        Coroutine();
+        // owner: the VM which created the coroutine
+        Coroutine(const Value& function, std::vector<Value>&& args, const void* owner);
+
+        inline Status status() const
+        {
+            return m_status;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const Coroutine& C);
+
+        template <bool D> friend class Ark::VM_t;
+
+    private:
+        Status m_status;
+        const void* m_owner;
+
+        // the function and its arguments, until the coroutine is resumed for the first time
+        Value m_function;
+        std::vector<Value> m_args;
+
+        // state of a suspended coroutine
+        std::vector<Frame> m_frames;  // stack bases relative to the first value of the coroutine
+        std::vector<Value> m_stack;
+        std::vector<Scope_t> m_scopes;
+        std::size_t m_ip;
+        std::size_t m_pp;
+        uint8_t m_caller_scopes;  // scopes of the coroutine deleted by the frame which resumed it (closures environments)
+
+        // state of a running coroutine
+        std::size_t m_frames_base;  // number of frames under the ones of the coroutine
+        std::size_t m_locals_base;  // number of scopes under the ones of the coroutine
+        uint8_t m_caller_scope_count;  // scopes to delete of the frame which resumed it, before it was resumed
+    };
+
+    inline Coroutine& Value::coroutine_ref()
+    {
+        return static_cast<Cell_t<Coroutine>*>(m_cell)->data;
+    }
+
+    inline const Coroutine& Value::coroutine() const
+    {
+        return data<Coroutine>();
+    }
+}
+
+#endif
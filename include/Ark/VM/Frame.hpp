@@ -14,7 +14,7 @@ namespace Ark::internal
 {
     /*
         A frame should hold:
-        - its own stack
+        - the position of its first value in the VM stack (its arguments, when it's a function's frame)
         - a return address to a possible caller (if it's a function's frame)
     */
     class Frame
@@ -22,54 +22,47 @@ namespace Ark::internal
     public:
         Frame();
         Frame(const Frame&) = default;
-        Frame(std::size_t caller_addr, std::size_t caller_page_addr, std::size_t new_pp);
+        Frame(std::size_t caller_addr, std::size_t caller_page_addr, std::size_t new_pp, std::size_t stack_base);
 
-        // stack related
+        // getters-setters (misc)
 
-        inline Value* pop()
+        inline std::size_t stackBase() const
         {
-            m_i--;
-            return &m_stack[m_i];
+            return m_base;
         }
 
-        inline void push(const Value& value)
+        inline std::size_t callerAddr() const
         {
-            m_stack[m_i] = value;
-            m_i++;
-
-            if (m_i == m_stack.size())
-                m_stack.emplace_back(FFI::undefined);
+            return m_addr;
         }
 
-        inline void push(Value&& value)
+        inline std::size_t callerPageAddr() const
         {
-            m_stack[m_i] = std::move(value);
-            m_i++;
-
-            if (m_i == m_stack.size())
-                m_stack.emplace_back(FFI::undefined);
+            return m_page_addr;
         }
 
-        // getters-setters (misc)
-
-        inline std::size_t stackSize() const
+        inline std::size_t currentPageAddr() const
         {
-            return m_i;
+            return m_new_pp;
         }
 
-        inline std::size_t callerAddr() const
+        // used by tail calls, which run another function in the same frame
+        inline void setCurrentPageAddr(std::size_t new_pp)
         {
-            return m_addr;
+            m_new_pp = new_pp;
         }
 
-        inline std::size_t callerPageAddr() const
+        // used by coroutines, whose frames are moved out of the VM and back, maybe somewhere
+        // else in the stack and for another caller
+        inline void setStackBase(std::size_t base)
         {
-            return m_page_addr;
+            m_base = base;
         }
 
-        inline std::size_t currentPageAddr() const
+        inline void setCaller(std::size_t caller_addr, std::size_t caller_page_addr)
         {
-            return m_new_pp;
+            m_addr = caller_addr;
+            m_page_addr = caller_page_addr;
         }
 
         // related to scope deletion
@@ -83,22 +76,38 @@ namespace Ark::internal
         {
             m_scope_to_delete = 0;
         }
+
+        inline void setScopeCountToDelete(uint8_t count)
+        {
+            m_scope_to_delete = count;
+        }
         
         inline uint8_t scopeCountToDelete() const
         {
             return m_scope_to_delete;
         }
 
+        // a tail call put the variables hidden by the locals of the called function in a scope
+        // under its own one
+        inline bool hasHiddenScope() const
+        {
+            return m_hidden_scope;
+        }
+
+        inline void setHiddenScope(bool value)
+        {
+            m_hidden_scope = value;
+        }
+
         friend std::ostream& operator<<(std::ostream& os, const Frame& F);
     
     private:
         //              IP,          PP    EXC_PP
         std::size_t m_addr, m_page_addr, m_new_pp;
-
-        std::vector<Value> m_stack;
-        int16_t m_i;
+        std::size_t m_base;
 
         uint8_t m_scope_to_delete;
+        bool m_hidden_scope;
     };
 }
 
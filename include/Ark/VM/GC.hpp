@@ -0,0 +1,76 @@
+#ifndef ark_vm_gc
+#define ark_vm_gc
+
+#include <vector>
+#include <memory>
+#include <cinttypes>
+
+#include <Ark/VM/Value.hpp>
+#include <Ark/VM/Scope.hpp>
+#include <Ark/VM/Closure.hpp>
+#include <Ark/Constants.hpp>
+
+namespace Ark::internal
+{
+    /*
+        Collector for the scopes only kept alive by reference cycles, eg a closure stored in the
+        environment it captured. Values and scopes are still freed by their reference counts, the
+        collector looks for the scopes, closures and lists referencing each other without being
+        referenced from anywhere else (the VM, a plugin...), and empties those scopes to break the cycles.
+
+        New scopes go into a nursery: most of them (functions scopes) are freed before the next minor
+        collection, which forgets about them and keeps the other ones. A full collection runs when
+        more than `threshold' scopes survived the nursery.
+    */
+    class GC
+    {
+    public:
+        struct Stats
+        {
+            std::size_t minor_collections = 0;
+            std::size_t collections = 0;     // full collections
+            std::size_t freed_scopes = 0;    // scopes emptied because only cycles referenced them
+            std::size_t tracked_scopes = 0;  // scopes which survived the nursery, after the last collection
+            std::size_t threshold = 0;
+            double time_ms = 0;              // time spent in the full collections
+        };
+
+        explicit GC(std::size_t threshold=ARK_GC_THRESHOLD);
+        // the scopes left are only referenced by cycles when the collector is destroyed with the VM
+        ~GC();
+
+        inline void track(const Scope_t& scope)
+        {
+            m_nursery.push_back(scope);
+            if (m_nursery.size() >= NurserySize)
+                minorCollection();
+        }
+
+        void minorCollection();
+        void collect();
+
+        void setThreshold(std::size_t threshold);
+        const Stats& stats() const;
+
+    private:
+        static constexpr std::size_t NurserySize = 1024;
+
+        enum class Kind { Scope, List, Closure };
+
+        std::vector<std::weak_ptr<Scope>> m_nursery;
+        std::vector<std::weak_ptr<Scope>> m_tracked;
+        std::size_t m_initial_threshold;
+        Stats m_stats;
+
+        // move the scopes still alive from the nursery to the tracked ones
+        void promote();
+
+        // call visit(pointer, kind, reference count) for each scope, list or closure referenced by the given object
+        template <typename F>
+        static void forEachReference(void* object, Kind kind, F&& visit);
+        template <typename F>
+        static void visitValue(const Value& value, F&& visit);
+    };
+}
+
+#endif
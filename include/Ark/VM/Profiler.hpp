@@ -0,0 +1,101 @@
+#ifndef ark_vm_profiler
+#define ark_vm_profiler
+
+#include <vector>
+#include <array>
+#include <string>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+#include <cinttypes>
+
+#include <Ark/VM/Types.hpp>
+
+namespace Ark::internal
+{
+    /*
+        Counts what the VM executes: each opcode, the instructions and calls of each page, and the
+        calls made from each call site. The VM tells it when a function is entered and left, to
+        measure the time spent in each function, with (inclusive) and without (exclusive) the
+        functions it called.
+
+        The VM records them in a separate instantiation of its dispatch loop, used only when the
+        profiler is enabled.
+    */
+    class Profiler
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct PageStats
+        {
+            std::size_t calls = 0;
+            std::size_t instructions = 0;
+            Clock::duration inclusive {0};  // a recursive function is only counted once
+            Clock::duration exclusive {0};
+        };
+
+        explicit Profiler(std::size_t pages_count);
+
+        inline void instruction(uint8_t inst, std::size_t page)
+        {
+            m_opcodes[inst]++;
+            m_pages[page].instructions++;
+        }
+
+        inline void callSite(std::size_t page, std::size_t ip)
+        {
+            m_call_sites[(static_cast<uint64_t>(page) << 32) | ip]++;
+        }
+
+        // the program can grow (REPL), make room for the new pages
+        void resize(std::size_t pages_count);
+
+        // a function was called, or a frame was given back to the VM (resumed coroutine)
+        void enter(PageAddr_t page);
+        void leave();
+        void leaveAll();
+
+        // number of functions being run, the global scope included
+        inline std::size_t depth() const
+        {
+            return m_stack.size();
+        }
+
+        inline const std::array<std::size_t, 256>& opcodes() const
+        {
+            return m_opcodes;
+        }
+
+        inline const std::vector<PageStats>& pages() const
+        {
+            return m_pages;
+        }
+
+        // call count of each call site, keyed by (page << 32 | instruction index)
+        inline const std::unordered_map<uint64_t, std::size_t>& callSites() const
+        {
+            return m_call_sites;
+        }
+
+        // display the functions, instructions and call sites, the most executed first. Pages are
+        // displayed with the given names
+        void report(std::ostream& os, const std::vector<std::string>& page_names) const;
+
+    private:
+        struct Entry
+        {
+            PageAddr_t page;
+            Clock::time_point start;
+            Clock::duration children {0};
+        };
+
+        std::array<std::size_t, 256> m_opcodes {};
+        std::vector<PageStats> m_pages;
+        std::vector<std::size_t> m_active;  // calls of each page being run, to count recursive functions once
+        std::unordered_map<uint64_t, std::size_t> m_call_sites;
+        std::vector<Entry> m_stack;
+    };
+}
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef ark_vm_sampler
+#define ark_vm_sampler
+
+#include <vector>
+#include <map>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+
+#include <Ark/VM/Types.hpp>
+
+namespace Ark::internal
+{
+    /*
+        Sampling profiler: a thread asks the VM for a sample at a regular interval, and the VM gives
+        it the pages of its frames (the functions being run) at its next tick. Between two samples, the
+        VM only checks a flag it already checks for cancellation.
+
+        The samples are written as folded stacks (function names separated by semicolons, followed by
+        the number of samples), read by the flame graph tools.
+    */
+    class Sampler
+    {
+    public:
+        // `request' is called by the sampling thread, and must ask the VM for a sample
+        Sampler(std::function<void()> request, std::chrono::microseconds interval);
+        ~Sampler();
+
+        // stop the sampling thread, keeping the samples
+        void stop();
+
+        Sampler(const Sampler&) = delete;
+        Sampler& operator=(const Sampler&) = delete;
+
+        // called by the VM, the global scope first
+        void record(const std::vector<PageAddr_t>& stack);
+
+        inline std::size_t samples() const
+        {
+            return m_samples;
+        }
+
+        // pages are written with the given names
+        void write(std::ostream& os, const std::vector<std::string>& page_names) const;
+
+    private:
+        std::map<std::vector<PageAddr_t>, std::size_t> m_stacks;
+        std::size_t m_samples;
+
+        std::mutex m_mutex;
+        std::condition_variable m_stop_requested;
+        bool m_stop;
+        std::thread m_thread;
+    };
+}
+
+#endif
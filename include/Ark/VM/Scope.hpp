@@ -0,0 +1,103 @@
+#ifndef ark_vm_scope
+#define ark_vm_scope
+
+#include <vector>
+#include <utility>
+#include <cinttypes>
+
+#include <Ark/VM/Value.hpp>
+
+namespace Ark::internal
+{
+    /*
+        A scope holds the variables defined in it, as (symbol id, value) pairs:
+        - a function scope is created with a slot for each local of the function
+          (computed by the compiler), thus its size is the number of locals
+        - the global scope has a slot for each symbol, slot i being symbol i
+        Other variables (plugins functions, captured variables...) are appended
+    */
+    class Scope
+    {
+    public:
+        Scope();
+        // one slot per symbol id given, in the same order
+        Scope(const std::vector<uint16_t>& symbols);
+        // one slot per symbol, slot i holding symbol i
+        explicit Scope(std::size_t symbols_count);
+
+        inline Value* find(uint16_t id)
+        {
+            // slot `id` is checked first, because in the global scope it holds the symbol `id`
+            if (id < m_data.size() && m_data[id].first == id)
+                return &m_data[id].second;
+
+            for (auto& pair : m_data)
+            {
+                if (pair.first == id)
+                    return &pair.second;
+            }
+            return nullptr;
+        }
+
+        inline Value& slot(uint16_t index)
+        {
+            return m_data[index].second;
+        }
+
+        inline uint16_t idOf(uint16_t index) const
+        {
+            return m_data[index].first;
+        }
+
+        inline std::size_t size() const
+        {
+            return m_data.size();
+        }
+
+        // the function called in parallel which created the scope, 0 if none
+        inline uint32_t owner() const
+        {
+            return m_owner;
+        }
+
+        inline void setOwner(uint32_t owner)
+        {
+            m_owner = owner;
+        }
+
+        Value& set(uint16_t id, const Value& value);
+        Value& set(uint16_t id, Value&& value);
+
+        // remove every variable and create one slot per symbol, as the constructor does, keeping the memory
+        void reset(std::size_t symbols_count);
+        // remove every variable and create one slot per symbol id given, keeping the memory
+        void reset(const std::vector<uint16_t>& symbols);
+
+        // make room for the given number of variables, without creating them
+        void reserve(std::size_t count);
+
+        // used to extend the global scope when the symbols table grows
+        void resize(std::size_t symbols_count);
+
+        // copy the variables defined in the given scope, which are not in this one. The ones hidden
+        // by a variable of this scope go into `hidden', if given
+        void inherit(const Scope& scope, Scope* hidden=nullptr);
+        // remove every variable, except the ones which are not in the given symbol ids, and create one
+        // slot per symbol id given before them. The defined variables removed go into `hidden', if given
+        void reuse(const std::vector<uint16_t>& symbols, Scope* hidden=nullptr);
+        // does this scope have a value for one of the given symbol ids
+        bool defines(const std::vector<uint16_t>& symbols) const;
+
+        // only used to display the call stack traceback
+        std::vector<std::pair<uint16_t, Value>>::const_iterator begin() const;
+        std::vector<std::pair<uint16_t, Value>>::const_iterator end() const;
+
+        friend class GC;
+
+    private:
+        std::vector<std::pair<uint16_t, Value>> m_data;
+        uint32_t m_owner;
+    };
+}
+
+#endif
\ No newline at end of file
@@ -5,6 +5,9 @@
 #include <vector>
 #include <cinttypes>
 #include <unordered_map>
+#include <optional>
+#include <memory>
+#include <mutex>
 
 #include <Ark/VM/Value.hpp>
 #include <Ark/Compiler/BytecodeReader.hpp>
@@ -14,6 +17,13 @@
 
 namespace Ark
 {
+    struct SourceLocation
+    {
+        std::string file;
+        uint16_t line;
+        uint16_t col;
+    };
+
     class State
     {
     public:
@@ -31,16 +41,71 @@ namespace Ark
         void loadFunction(const std::string& name, internal::Value::ProcType function);
         void setDebug(unsigned level);
 
+        /*
+            Once frozen, the state can not be modified anymore (feed, doFile, doString, loadFunction
+            and setDebug throw), and can be shared by VMs running on different threads: they only
+            read it. The functions of the plugins and the binded ones are loaded once for all the VMs
+        */
+        void freeze();
+
+        inline bool frozen() const
+        {
+            return m_frozen;
+        }
+
+        /*
+            From the debug information of the bytecode, if the compiler added it: the source location
+            of an instruction (index in the page, as used by the VM), and the name of the variable a
+            page was bound to (empty if unknown). It's read the first time it is needed, running
+            programs don't pay for it
+        */
+        std::optional<SourceLocation> sourceLocation(internal::PageAddr_t page, std::size_t ip) const;
+        std::string pageName(internal::PageAddr_t page) const;
+
         template <bool D> friend class VM_t;
     
     private:
+        struct DebugInfo
+        {
+            struct Entry
+            {
+                std::size_t ip;  // first instruction of the page at this location
+                uint16_t file;
+                uint16_t line;
+                uint16_t col;
+            };
+
+            std::vector<std::string> files;
+            std::vector<std::string> page_names;
+            std::vector<std::vector<Entry>> locations;  // by page, sorted by ip
+        };
+
         void configure();
+        std::vector<internal::Word> decodePage(const bytecode_t& page);
+        // number of bytes of an instruction and its arguments, 0 if the instruction is unknown
+        static std::size_t instructionSize(uint8_t inst);
+        const DebugInfo* debugInfo() const;
+
+        // id of a symbol from its name, if the bytecode uses it
+        inline std::optional<uint16_t> symbolId(const std::string& name) const
+        {
+            auto it = m_symbol_ids.find(name);
+            if (it != m_symbol_ids.end())
+                return it->second;
+            return {};
+        }
 
         inline void throwStateError(const std::string& message)
         {
             throw std::runtime_error("StateError: " + message);
         }
 
+        inline void checkNotFrozen(const std::string& action)
+        {
+            if (m_frozen)
+                throwStateError("can not " + action + ", the state is frozen");
+        }
+
         unsigned m_debug_level;
 
         bytecode_t m_bytecode;
@@ -50,13 +115,27 @@ namespace Ark
 
         // related to the bytecode
         std::vector<std::string> m_symbols;
+        std::unordered_map<std::string, uint16_t> m_symbol_ids;  // name -> index in m_symbols
         std::vector<internal::Value> m_constants;
         std::vector<std::string> m_plugins;
         std::vector<internal::SharedLibrary> m_shared_lib_objects;
-        std::vector<bytecode_t> m_pages;
+        std::vector<std::vector<internal::Word>> m_pages;
+        // symbols ids of the locals of each page, in slot order
+        std::vector<std::vector<uint16_t>> m_page_locals;
+        // arity, locals count and maximum stack depth of each page, as given by the compiler
+        std::vector<internal::FunctionInfo> m_functions;
+        // where the instructions of each page start in the bytecode, and where the debug information
+        // is (0 if there is none), to read it later
+        std::vector<std::size_t> m_page_starts;
+        std::size_t m_debug_start;
+        mutable std::unique_ptr<DebugInfo> m_debug_info;
+        mutable std::mutex m_debug_mutex;
 
         // related to the execution
         std::unordered_map<std::string, internal::Value::ProcType> m_binded_functions;
+        bool m_frozen;
+        // binded and plugins functions, with the id of their symbol, loaded when freezing the state
+        std::vector<std::pair<uint16_t, internal::Value>> m_frozen_functions;
     };
 }
 
@@ -7,6 +7,28 @@ namespace Ark::internal
 {
     enum class NFT { Nil, False, True, Undefined };
     using PageAddr_t = uint16_t;
+
+    // an instruction and its argument, decoded once by the State when loading the
+    // bytecode, so that the VM doesn't have to rebuild them every time it runs them
+    struct Word
+    {
+        uint8_t opcode = 0;
+        uint8_t padding = 0;
+        uint16_t data = 0;
+
+        Word() = default;
+        Word(uint8_t inst, uint16_t arg=0) :
+            opcode(inst), data(arg)
+        {}
+    };
+
+    // metadata of a code page, computed by the compiler
+    struct FunctionInfo
+    {
+        uint16_t arity = 0;      // number of arguments, 0 for the global page and the quoted code
+        uint16_t locals = 0;     // number of local slots
+        uint16_t max_stack = 0;  // maximum number of values on the stack of its frame
+    };
 }
 
 #endif
\ No newline at end of file
@@ -9,9 +9,22 @@
 #include <memory>
 #include <unordered_map>
 #include <utility>
+#include <thread>
+#include <mutex>
+#include <deque>
+#include <atomic>
+#include <exception>
+#include <chrono>
+#include <limits>
 
 #include <Ark/VM/Value.hpp>
+#include <Ark/VM/Scope.hpp>
 #include <Ark/VM/Frame.hpp>
+#include <Ark/VM/Coroutine.hpp>
+#include <Ark/VM/Callback.hpp>
+#include <Ark/VM/GC.hpp>
+#include <Ark/VM/Profiler.hpp>
+#include <Ark/VM/Sampler.hpp>
 #include <Ark/VM/State.hpp>
 #include <Ark/VM/Plugin.hpp>
 #include <Ark/FFI/FFI.hpp>
@@ -30,88 +43,213 @@ namespace Ark
     public:
         VM_t(State* state);
 
+        // values returned by run() and continueRun(), besides 0 (the program ended) and 1 (an error occured)
+        static constexpr int Yielded = 2;    // the budget ran out, continueRun() goes on from where the VM stopped
+        static constexpr int Cancelled = 3;  // cancel() was called
+
         int run();
+        int continueRun();
+        // forget everything about the last run (even with FeaturePersist), keeping the memory allocated
+        // by the VM (stack, frames, global scope) to run again without reallocating it
+        void reset();
+
+        // execution budget of each run and continuation, counted in ticks: a tick is a backward jump or a
+        // call, the points where the VM checks its budget. 0 for no limit. Only run() and continueRun()
+        // can yield, the functions called with call() or resolve() run until they return
+        void setBudget(std::size_t ticks);
+        // the VM yields at its first tick after the deadline, the clock being read every few ticks
+        void setDeadline(std::chrono::steady_clock::time_point deadline);
+        void clearDeadline();
+
+        // can be called from any thread: the VM stops at its next tick, and run() or continueRun()
+        // return Cancelled. A function called from C++ (call(), a Function handle) throws
+        // ExecutionCancelled instead, the VM being where it was before the call
+        inline void cancel()
+        {
+            m_interrupts.fetch_or(InterruptCancel, std::memory_order_relaxed);
+        }
 
         internal::Value& operator[](const std::string& name);
 
+        // a script function looked up once, to be called many times from C++ without searching for it
+        // again. The handle keeps the value the function had when it was created, even if the program
+        // binds another value to its name afterwards
+        class Function
+        {
+        public:
+            template <typename... Args>
+            inline internal::Value operator()(Args&&... args)
+            {
+                return m_vm->callFunction(m_function, m_id, std::forward<Args>(args)...);
+            }
+
+            inline const internal::Value& value() const
+            {
+                return m_function;
+            }
+
+            friend class VM_t;
+
+        private:
+            VM_t* m_vm;
+            internal::Value m_function;
+            uint16_t m_id;
+
+            Function(VM_t* vm, const internal::Value& function, uint16_t id) :
+                m_vm(vm), m_function(function), m_id(id)
+            {}
+        };
+
+        Function function(const std::string& name);
+
         template <typename... Args>
         internal::Value call(const std::string& name, Args&&... args)
         {
-            using namespace Ark::internal;
+            return function(name)(std::forward<Args>(args)...);
+        }
 
-            // reset ip and pp
-            m_ip = m_pp = 0;
+        // most executed sequences of `length' (2 or 3) opcodes with their count, the most executed
+        // first. Only the debug VM counts them
+        std::vector<std::pair<std::vector<uint8_t>, std::size_t>> hottestOpcodeSequences(std::size_t length, std::size_t count) const;
 
-            // find id of function
-            auto it = std::find(m_state->m_symbols.begin(), m_state->m_symbols.end(), name);
-            if (it == m_state->m_symbols.end())
-                throwVMError("Couldn't find symbol with name " + name);
+        // collector of the scopes kept alive by reference cycles, enabled by FeatureGarbageCollector
+        inline const internal::GC::Stats& gcStats() const
+        {
+            return m_gc.stats();
+        }
 
-            // convert and push arguments in reverse order
-            std::vector<Value> fnargs { { args... } };
-            for (auto it2=fnargs.rbegin(); it2 != fnargs.rend(); ++it2)
-                push(*it2);
-            
-            // find function object and push it if it's a pageaddr/closure
-            uint16_t id = static_cast<uint16_t>(std::distance(m_state->m_symbols.begin(), it));
-            auto var = findNearestVariable(id);
-            if (var != nullptr)
-            {
-                if (var->valueType() != ValueType::PageAddr && var->valueType() != ValueType::Closure)
-                    throwVMError("Symbol " + name + " isn't a function");
+        inline void setGCThreshold(std::size_t threshold)
+        {
+            m_gc.setThreshold(threshold);
+        }
 
-                push(*var);
-                m_last_sym_loaded = id;
-            }
-            else
-                throwVMError("Couldn't load symbol with name " + name);
-
-            std::size_t frames_count = m_frames.size();
-            // call it
-            call(static_cast<int16_t>(sizeof...(Args)));
-            // reset instruction pointer, otherwise the safeRun method will start at ip = -1
-            // without doing m_ip++ as intended (done right after the call() in the loop, but here
-            // we start outside this loop)
-            m_ip = 0;
-
-            // run until the function returns
-            safeRun(/* untilFrameCount */ frames_count);
-
-            // get result
-            if (m_frames.back().stackSize() != 0)
-                return *pop();
-            else
-                return FFI::nil;
+        inline void collectGarbage()
+        {
+            m_gc.collect();
+        }
+
+        // count the instructions and calls executed by the next runs, and the time spent in each function.
+        // They are recorded by a separate instantiation of the dispatch loop, the VM doesn't pay for the
+        // profiler when it is disabled
+        void enableProfiler();
+
+        inline const internal::Profiler* profiler() const
+        {
+            return m_profiler.get();
         }
 
+        // display what the profiler recorded, the pages being named after the variables holding them
+        void profileReport(std::ostream& os);
+
+        // sample the functions being run at the given interval, from another thread, until stopSampling().
+        // The VM takes the samples at its ticks (backward jumps and calls), thus a long function without
+        // loops nor calls is seen at the next tick after it
+        void startSampling(std::chrono::microseconds interval=std::chrono::microseconds(1000));
+        void stopSampling();
+        // one line per sampled stack, its functions separated by semicolons followed by its number of
+        // samples, as read by the flame graph tools
+        void writeFoldedStacks(std::ostream& os);
+
+        // call the function with each argument on worker VMs sharing the state, running on as many
+        // threads as the hardware supports, and give back the results in the order of the arguments.
+        // The function can read the variables of the caller but not modify them
+        std::vector<internal::Value> parallelCall(const internal::Value& function, const std::vector<internal::Value>& args);
+
         friend class internal::Value;
+        friend class internal::Callback;
+        template <bool> friend class VM_t;
 
     private:
         State* m_state;
+        // declared before the scopes and the stack, to be destroyed after them and free the cycles left
+        internal::GC m_gc;
         
-        int m_ip;           // instruction pointer
+        std::size_t m_ip;   // instruction pointer
         std::size_t m_pp;   // page pointer
         bool m_running;
         uint16_t m_last_sym_loaded;
         std::size_t m_until_frame_count;
 
+        // execution budget
+        static constexpr std::size_t DeadlineCheckInterval = 1024;  // ticks between two readings of the clock
+        static constexpr std::size_t NoLimit = std::numeric_limits<std::size_t>::max();
+        std::size_t m_budget;       // ticks given to each run, 0 for no limit
+        std::size_t m_budget_left;
+        std::size_t m_ticks_left;   // before the next check of the budget
+        std::size_t m_ticks_armed;  // value of m_ticks_left after the last check
+        std::optional<std::chrono::steady_clock::time_point> m_deadline;
+        // set from other threads, checked by the VM at each tick
+        static constexpr uint8_t InterruptCancel = 1;
+        static constexpr uint8_t InterruptSample = 2;
+        std::atomic<uint8_t> m_interrupts;
+        bool m_suspended;           // by the budget, waiting for continueRun()
+
         // related to the execution
+        std::vector<internal::Value> m_stack;  // shared by all the frames
+        std::size_t m_sp;  // stack pointer, index of the first free slot
         std::vector<internal::Frame> m_frames;
         std::optional<internal::Scope_t> m_saved_scope;
         std::vector<internal::Scope_t> m_locals;
+        std::vector<internal::Value> m_coroutines;  // the coroutines being run, the innermost one last
+
+        std::unique_ptr<internal::Profiler> m_profiler;
+        // destroyed before the interrupts, which its thread writes to
+        std::unique_ptr<internal::Sampler> m_sampler;
+        std::vector<internal::PageAddr_t> m_sampled_stack;
+
+        // used by parallelCall, created the first time they are needed
+        std::vector<std::unique_ptr<VM_t<false>>> m_workers;
+        // in a worker: the parallel call being run (0 otherwise), and its copies of the closures environments
+        uint32_t m_worker_run;
+        std::unordered_map<const internal::Scope*, internal::Scope_t> m_worker_envs;
+
+        // executed opcodes (debug VM only): the last three ones, and the count of each pair and triple
+        uint32_t m_last_opcodes;
+        std::size_t m_opcodes_count;
+        std::unordered_map<uint32_t, std::size_t> m_opcode_sequences;
 
         // just a nice little trick for operator[]
         internal::Value m__no_value = internal::FFI::nil;
 
         void configure();
-        int safeRun(std::size_t untilFrameCount=0);
+
+        inline int safeRun(std::size_t untilFrameCount=0)
+        {
+            if (m_profiler)
+                return runLoop<true>(untilFrameCount);
+            return runLoop<false>(untilFrameCount);
+        }
+
+        template <bool profile>
+        int runLoop(std::size_t untilFrameCount);
         void init();
 
-        inline uint16_t readNumber()
+        // give the budget to a new run or continuation
+        void resetBudget();
+        void armBudget();
+        // called when m_ticks_left reaches 0 or when the VM is interrupted, true if the run must yield
+        bool budgetExhausted();
+        void takeSample();
+
+        // give a worker a copy of the scopes of the VM calling it, with an empty stack
+        void prepareWorker(const std::vector<internal::Scope_t>& scopes);
+        internal::Value workerCall(const internal::Value& function, const internal::Value& arg);
+
+        // the environment of a closure, copied the first time a worker uses it when it wasn't created by the worker
+        inline const internal::Scope_t& closureScope(internal::Closure& closure)
         {
-            auto x = (static_cast<uint16_t>(m_state->m_pages[m_pp][m_ip]) << 8); ++m_ip;
-            auto y = (static_cast<uint16_t>(m_state->m_pages[m_pp][m_ip])     );
-            return x + y;
+            const internal::Scope_t& env = closure.scope();
+            if (m_worker_run == 0 || env->owner() == m_worker_run)
+                return env;
+
+            internal::Scope_t& copy = m_worker_envs[env.get()];
+            if (!copy)
+            {
+                copy = std::make_shared<internal::Scope>(*env);
+                copy->setOwner(m_worker_run);
+                trackScope(copy);
+            }
+            return copy;
         }
 
         // locals related
@@ -120,25 +258,25 @@ namespace Ark
         inline internal::Value& registerVariable(uint16_t id, internal::Value&& value)
         {
             if constexpr (pp == -1)
-                return (*m_locals.back())[id] = value;
-            return (*m_locals[pp])[id] = value;
+                return m_locals.back()->set(id, std::move(value));
+            return m_locals[pp]->set(id, std::move(value));
         }
 
         template <int pp=-1>
         inline internal::Value& registerVariable(uint16_t id, const internal::Value& value)
         {
             if constexpr (pp == -1)
-                return (*m_locals.back())[id] = value;
-            return (*m_locals[pp])[id] = value;
+                return m_locals.back()->set(id, value);
+            return m_locals[pp]->set(id, value);
         }
 
-        // could be optimized
         inline internal::Value* findNearestVariable(uint16_t id)
         {
             for (auto it=m_locals.rbegin(); it != m_locals.rend(); ++it)
             {
-                if ((**it)[id] != internal::FFI::undefined)
-                    return &(**it)[id];
+                internal::Value* var = (*it)->find(id);
+                if (var != nullptr && *var != internal::FFI::undefined)
+                    return var;
             }
             return nullptr;
         }
@@ -148,31 +286,29 @@ namespace Ark
         {
             for (auto it=m_locals.rbegin(); it != m_locals.rend(); ++it)
             {
-                for (auto sub=(*it)->begin(); sub != (*it)->end(); ++sub)
+                for (auto&& [id, var] : **it)
                 {
-                    if (*sub == value)
-                        return static_cast<uint16_t>(std::distance((*it)->begin(), sub));
+                    if (var == value)
+                        return id;
                 }
             }
             // oversized by one: didn't find anything
             return static_cast<uint16_t>(m_state->m_symbols.size());
         }
 
-        template<int pp=-1>
-        inline internal::Value& getVariableInScope(uint16_t id)
+        // nullptr if the variable doesn't belong to the current scope
+        inline internal::Value* getVariableInScope(uint16_t id)
         {
-            if constexpr (pp == -1)
-                return (*m_locals.back())[id];
-            return (*m_locals[pp])[id];
+            return m_locals.back()->find(id);
         }
 
         inline void returnFromFuncCall()
         {
-            // remove frame
+            // remove frame and the values it left on the stack
+            m_sp = m_frames.back().stackBase();
             m_frames.pop_back();
             uint8_t del_counter = m_frames.back().scopeCountToDelete();
 
-            // high cpu cost
             m_locals.pop_back();
             
             while (del_counter != 0)
@@ -187,30 +323,137 @@ namespace Ark
                 m_running = false;
         }
 
-        inline void createNewScope()
+        inline void createNewScope(internal::PageAddr_t page, internal::Scope_t* reusable=nullptr)
         {
-            // high cpu cost
+            // the scope kept by a callback is reused when its last call didn't capture it
+            if (reusable != nullptr && *reusable && reusable->use_count() == 1)
+            {
+                (*reusable)->reset(m_state->m_page_locals[page]);
+                m_locals.push_back(*reusable);
+                return;
+            }
+
+            // only holds the locals of the function, as given by the compiler
             m_locals.emplace_back(
-                std::make_shared<std::vector<internal::Value>>(
-                    m_state->m_symbols.size(), internal::FFI::undefined
-                )
+                std::make_shared<internal::Scope>(m_state->m_page_locals[page])
             );
+            trackScope(m_locals.back());
+            if (reusable != nullptr)
+                *reusable = m_locals.back();
+        }
+
+        // coroutines
+
+        // run a coroutine until it yields or returns, on top of the current frame. `sent' is the
+        // value of the yield expression it stopped at
+        void resume(internal::Value&& coroutine, internal::Value&& sent);
+        // suspend the innermost coroutine being run, and give the value to the frame which resumed it
+        void yield(internal::Value&& value);
+
+        inline void finishCoroutine()
+        {
+            m_coroutines.back().coroutine_ref().m_status = internal::Coroutine::Status::Done;
+            m_coroutines.pop_back();
+        }
+
+        // the coroutines running above the given frame lost their frames (to an error)
+        inline void abortCoroutines(std::size_t frames_count)
+        {
+            while (!m_coroutines.empty() && m_coroutines.back().coroutine_ref().m_frames_base >= frames_count)
+                finishCoroutine();
+        }
+
+        // tell the profiler about the frames created or removed since the last time
+        inline void syncProfiler()
+        {
+            while (m_profiler->depth() > m_frames.size())
+                m_profiler->leave();
+            while (m_profiler->depth() < m_frames.size())
+                m_profiler->enter(static_cast<internal::PageAddr_t>(m_frames[m_profiler->depth()].currentPageAddr()));
+        }
+
+        // the outermost run leaves every function, a nested one only the functions it ran
+        inline void stopProfiler(std::size_t untilFrameCount)
+        {
+            if (untilFrameCount == 0)
+                m_profiler->leaveAll();
+            else
+                syncProfiler();
+        }
+
+        // name of each page, from the variables of the global scope holding them
+        std::vector<std::string> pageNames();
+
+        inline void trackScope(const internal::Scope_t& scope)
+        {
+            if (m_state->m_options & FeatureGarbageCollector)
+                m_gc.track(scope);
+        }
+
+        inline void countOpcode(uint8_t inst)
+        {
+            m_last_opcodes = ((m_last_opcodes << 8) | inst) & 0xffffff;
+            m_opcodes_count++;
+
+            // the length of the sequence is stored in the upper byte of the key
+            if (m_opcodes_count >= 2)
+                m_opcode_sequences[(2u << 24) | (m_last_opcodes & 0xffff)]++;
+            if (m_opcodes_count >= 3)
+                m_opcode_sequences[(3u << 24) | m_last_opcodes]++;
         }
 
         // error handling
 
-        inline void throwVMError(const std::string& message)
+        [[noreturn]] inline void throwVMError(const std::string& message)
         {
             throw std::runtime_error("VMError: " + message);
         }
 
         // stack management
 
-        inline internal::Value* pop(int page=-1);
+        inline internal::Value* pop();
         inline void push(const internal::Value& value);
         inline void push(internal::Value&& value);
+        void growStack();
+
+        // make room at once for the values pushed by the current function, push checks it anyway
+        inline void reserveStack()
+        {
+            while (m_sp + m_state->m_functions[m_pp].max_stack > m_stack.size())
+                growStack();
+        }
 
-        inline void call(int16_t argc_=-1);
+        // number of values on the stack of the current frame
+        inline std::size_t stackSize() const
+        {
+            return m_sp - m_frames.back().stackBase();
+        }
+
+        // `scope' is the scope kept by a callback, to create the scope of the function
+        inline void call(uint16_t argc, internal::Scope_t* scope=nullptr);
+        inline void callNative(internal::Value::NativeProcType proc, uint16_t argc);
+        inline void tailCall(uint16_t argc);
+        inline void checkArity(std::size_t argc);
+        inline void increment(internal::Value* var, const internal::Value& cst, uint16_t id, bool add, bool constant_first);
+
+        // call the function on top of the stack, with its arguments under it, and run until it returns.
+        // The VM is where it was before afterwards, even if the function failed (a VM error with the
+        // given message is thrown) or the VM was cancelled (ExecutionCancelled is thrown)
+        internal::Value callFromHost(uint16_t argc, internal::Scope_t* scope, const char* failure);
+
+        // call a function from C++ and run until it returns, the VM being where it was before afterwards
+        template <typename... Args>
+        internal::Value callFunction(const internal::Value& function, uint16_t id, Args&&... args)
+        {
+            using namespace Ark::internal;
+
+            // convert and push arguments, the first one being the deepest in the stack
+            (push(Value(std::forward<Args>(args))), ...);
+            push(function);
+            m_last_sym_loaded = id;
+
+            return callFromHost(static_cast<uint16_t>(sizeof...(Args)), nullptr, "a function called from C++ failed");
+        }
 
         // function calling from plugins
 
@@ -224,37 +467,29 @@ namespace Ark
                 val->valueType() != ValueType::CProc)
                 throw Ark::TypeError("Value::resolve couldn't resolve a non-function");
             
-            int ip = m_ip;
-            std::size_t pp = m_pp;
-
-            // convert and push arguments in reverse order
-            std::vector<Value> fnargs { { args... } };
-            for (auto it=fnargs.rbegin(); it != fnargs.rend(); ++it)
-                push(*it);
-            // push function
+            // convert and push arguments, the first one being the deepest in the stack
+            (push(Value(std::forward<Args>(args))), ...);
+            // push function, which has no name
             push(*val);
+            m_last_sym_loaded = static_cast<uint16_t>(m_state->m_symbols.size());
 
-            std::size_t frames_count = m_frames.size();
-            // call it
-            call(static_cast<int16_t>(sizeof...(Args)));
-            // reset instruction pointer, otherwise the safeRun method will start at ip = -1
-            // without doing m_ip++ as intended (done right after the call() in the loop, but here
-            // we start outside this loop)
-            m_ip = 0;
+            return callFromHost(static_cast<uint16_t>(sizeof...(Args)), nullptr, "a function called by a plugin failed");
+        }
 
-            // run until the function returns
-            safeRun(/* untilFrameCount */ frames_count);
+        template <typename... Args>
+        internal::Value callCallback(internal::Callback& callback, Args&&... args)
+        {
+            using namespace Ark::internal;
 
-            // restore VM state
-            m_ip = ip;
-            m_pp = pp;
+            // convert and push arguments, the first one being the deepest in the stack
+            (push(Value(std::forward<Args>(args))), ...);
+            push(callback.m_function);
+            m_last_sym_loaded = static_cast<uint16_t>(m_state->m_symbols.size());
 
-            // get result
-            if (m_frames.back().stackSize() != 0)
-                return *pop();
-            else
-                return FFI::nil;
+            return callFromHost(static_cast<uint16_t>(sizeof...(Args)), &callback.m_scope, "a callback failed");
         }
+
+        std::vector<internal::Value> mapCallback(internal::Callback& callback, const std::vector<internal::Value>& args);
     };
 }
 
@@ -275,6 +510,7 @@ namespace Ark
     // aliases
     using Value = internal::Value;
     using ValueType = internal::ValueType;
+    using Callback = internal::Callback;
     const Value Nil = Value(internal::NFT::Nil);
     const Value False = Value(internal::NFT::False);
     const Value True = Value(internal::NFT::True);
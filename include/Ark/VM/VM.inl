@@ -1,8 +1,23 @@
+// GCC and Clang support labels as values, which let us build a direct threaded dispatch
+// in runLoop. Other compilers fall back to a plain switch
+#ifndef ARK_USE_COMPUTED_GOTO
+    #if defined(__GNUC__) || defined(__clang__)
+        #define ARK_USE_COMPUTED_GOTO 1
+    #else
+        #define ARK_USE_COMPUTED_GOTO 0
+    #endif
+#endif
+
 template<bool debug>
 VM_t<debug>::VM_t(State* state) :
     m_state(state),
     m_ip(0), m_pp(0), m_running(false),
-    m_last_sym_loaded(0), m_until_frame_count(0)
+    m_last_sym_loaded(0), m_until_frame_count(0),
+    m_budget(0), m_budget_left(NoLimit), m_ticks_left(NoLimit), m_ticks_armed(NoLimit),
+    m_interrupts(0), m_suspended(false),
+    m_stack(ARK_STACK_SIZE), m_sp(0),
+    m_worker_run(0),
+    m_last_opcodes(0), m_opcodes_count(0)
 {
     m_frames.reserve(128);
     m_locals.reserve(128);
@@ -18,6 +33,7 @@ void VM_t<debug>::init()
     {
         m_frames.clear();
         m_frames.emplace_back();
+        m_sp = 0;
     }
     else if (m_frames.size() == 0)
     {
@@ -31,27 +47,47 @@ void VM_t<debug>::init()
     // clearing locals (scopes) and create a global scope
     if ((m_state->m_options & FeaturePersist) == 0)
     {
-        m_locals.clear();
-        createNewScope();
+        // the global scope of the last run is reused if nothing else holds it
+        if (!m_locals.empty() && m_locals[0].use_count() == 1)
+        {
+            m_locals.resize(1);
+            m_locals[0]->reset(m_state->m_symbols.size());
+        }
+        else
+        {
+            m_locals.clear();
+            m_locals.emplace_back(std::make_shared<Scope>(m_state->m_symbols.size()));
+        }
     }
     else if (m_locals.size() == 0)
     {
         // if persistance is set but not scopes are present, add one
-        createNewScope();
+        m_locals.emplace_back(std::make_shared<Scope>(m_state->m_symbols.size()));
+    }
+    else if (m_locals[0]->size() < m_state->m_symbols.size())
+        // new symbols may have been added since the last run
+        m_locals[0]->resize(m_state->m_symbols.size());
+
+    // a frozen state already loaded them, for all the VMs using it
+    if (m_state->m_frozen)
+    {
+        for (auto&& [id, function] : m_state->m_frozen_functions)
+            registerVariable<0>(id, function);
+        return;
     }
 
     // loading binded functions
     // put them in the global frame if we can, aka the first one
     for (auto name_func : m_state->m_binded_functions)
     {
-        auto it = std::find(m_state->m_symbols.begin(), m_state->m_symbols.end(), name_func.first);
-        if (it == m_state->m_symbols.end())
+        auto id = m_state->symbolId(name_func.first);
+        if (!id)
         {
             if constexpr (debug)
                 Ark::logger.warn("Couldn't find symbol with name", name_func.first, "to set its value as a function");
         }
         else
-            registerVariable<0>(std::distance(m_state->m_symbols.begin(), it), Value(name_func.second));
+            registerVariable<0>(id.value(), Value(name_func.second));
     }
 
     // loading plugins
@@ -68,33 +104,389 @@ void VM_t<debug>::init()
         for (auto&& kv : map)
         {
             // put it in the global frame, aka the first one
-            auto it = std::find(m_state->m_symbols.begin(), m_state->m_symbols.end(), kv.first);
-            if (it != m_state->m_symbols.end())
+            auto id = m_state->symbolId(kv.first);
+            if (id)
             {
                 if constexpr (debug)
                     Ark::logger.info("Loading", kv.first);
 
-                registerVariable<0>(std::distance(m_state->m_symbols.begin(), it), Value(kv.second));
+                registerVariable<0>(id.value(), Value(kv.second));
             }
         }
     }
 }
 
+template<bool debug>
+void VM_t<debug>::reset()
+{
+    using namespace Ark::internal;
+
+    m_ip = 0;
+    m_pp = 0;
+    m_running = false;
+    m_until_frame_count = 0;
+    m_suspended = false;
+    m_interrupts.fetch_and(~InterruptCancel, std::memory_order_relaxed);
+
+    // release the values of the last run, including the ones left above the stack pointer. Only
+    // those stored in a cell hold memory
+    for (Value& value : m_stack)
+    {
+        if (value.isCell())
+            value = FFI::nil;
+    }
+    m_sp = 0;
+    m_frames.clear();
+    m_saved_scope.reset();
+    abortCoroutines(0);
+
+    if (!m_locals.empty() && m_locals[0].use_count() == 1)
+    {
+        m_locals.resize(1);
+        m_locals[0]->reset(m_state->m_symbols.size());
+    }
+    else
+        m_locals.clear();
+}
+
+template<bool debug>
+std::vector<internal::Value> VM_t<debug>::parallelCall(const internal::Value& function, const std::vector<internal::Value>& args)
+{
+    using namespace Ark::internal;
+
+    std::vector<Value> results(args.size());
+    if (args.empty())
+        return results;
+
+    // a few chunks per worker, given in order, so that the workers done first can steal the
+    // last chunks of the other ones when the cost of the calls is uneven
+    std::size_t workers_count = std::min<std::size_t>(std::max(std::thread::hardware_concurrency(), 1u), args.size());
+    std::size_t chunk_size = std::max<std::size_t>(args.size() / (workers_count * 4), 1);
+    std::size_t chunks_count = (args.size() + chunk_size - 1) / chunk_size;
+
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::deque<std::size_t> chunks;
+    };
+    std::vector<WorkQueue> queues(workers_count);
+    for (std::size_t chunk=0; chunk < chunks_count; ++chunk)
+        queues[chunk * workers_count / chunks_count].chunks.push_back(chunk);
+
+    while (m_workers.size() < workers_count)
+        m_workers.push_back(std::make_unique<VM_t<false>>(m_state));
+    for (std::size_t w=0; w < workers_count; ++w)
+        m_workers[w]->prepareWorker(m_locals);
+
+    std::atomic<bool> failed = false;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&](std::size_t w) {
+        try
+        {
+            while (!failed)
+            {
+                // the first chunk of our queue, or else the last one of another worker
+                std::optional<std::size_t> chunk;
+                for (std::size_t i=0; i < workers_count && !chunk; ++i)
+                {
+                    WorkQueue& queue = queues[(w + i) % workers_count];
+                    std::lock_guard<std::mutex> lock(queue.mutex);
+                    if (queue.chunks.empty())
+                        continue;
+
+                    if (i == 0)
+                    {
+                        chunk = queue.chunks.front();
+                        queue.chunks.pop_front();
+                    }
+                    else
+                    {
+                        chunk = queue.chunks.back();
+                        queue.chunks.pop_back();
+                    }
+                }
+                if (!chunk)
+                    break;
+
+                std::size_t end = std::min((chunk.value() + 1) * chunk_size, args.size());
+                for (std::size_t j=chunk.value() * chunk_size; j < end && !failed; ++j)
+                    results[j] = m_workers[w]->workerCall(function, args[j]);
+            }
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error)
+                error = std::current_exception();
+            failed = true;
+        }
+    };
+
+    // the calling thread is the first worker
+    std::vector<std::thread> threads;
+    for (std::size_t w=1; w < workers_count; ++w)
+        threads.emplace_back(work, w);
+    work(0);
+    for (std::thread& thread : threads)
+        thread.join();
+
+    if (error)
+        std::rethrow_exception(error);
+    return results;
+}
+
+template<bool debug>
+void VM_t<debug>::prepareWorker(const std::vector<internal::Scope_t>& scopes)
+{
+    using namespace Ark::internal;
+
+    m_ip = 0;
+    m_pp = 0;
+    m_sp = 0;
+    m_frames.clear();
+    m_frames.emplace_back();
+    m_saved_scope.reset();
+    abortCoroutines(0);
+
+    // each call gets its own number, given to the scopes the worker creates
+    static std::atomic<uint32_t> runs = 0;
+    m_worker_run = ++runs;
+    if (m_worker_run == 0)
+        m_worker_run = ++runs;
+
+    // the scopes, and the closures environments when they are used, are copied: what the function
+    // modifies stays in the worker, the caller and the other workers don't see it
+    m_worker_envs.clear();
+    m_locals.clear();
+    for (const Scope_t& scope : scopes)
+    {
+        m_locals.push_back(std::make_shared<Scope>(*scope));
+        m_locals.back()->setOwner(m_worker_run);
+    }
+}
+
+template<bool debug>
+internal::Value VM_t<debug>::workerCall(const internal::Value& function, const internal::Value& arg)
+{
+    using namespace Ark::internal;
+
+    // the function is called through a value, not a symbol
+    m_last_sym_loaded = static_cast<uint16_t>(m_state->m_symbols.size());
+    push(arg);
+    push(function);
+
+    std::size_t frames_count = m_frames.size();
+    ExecutionContext old_context = execution_context;
+    if constexpr (debug)
+        execution_context = ExecutionContext { nullptr, this };
+    else
+        execution_context = ExecutionContext { this, nullptr };
+
+    int out = 0;
+    try
+    {
+        call(1);
+        // builtins have already returned, functions run until they do
+        if (m_frames.size() > frames_count)
+            out = safeRun(/* untilFrameCount */ frames_count);
+    }
+    catch (...)
+    {
+        execution_context = old_context;
+        throw;
+    }
+    execution_context = old_context;
+
+    if (out != 0)
+        throwVMError("a function called in parallel failed");
+    return *pop();
+}
+
+template<bool debug>
+typename VM_t<debug>::Function VM_t<debug>::function(const std::string& name)
+{
+    using namespace Ark::internal;
+
+    auto id = m_state->symbolId(name);
+    if (!id)
+        throwVMError("Couldn't find symbol with name " + name);
+
+    Value* var = findNearestVariable(id.value());
+    if (var == nullptr)
+        throwVMError("Couldn't load symbol with name " + name);
+    if (var->valueType() != ValueType::PageAddr && var->valueType() != ValueType::Closure)
+        throwVMError("Symbol " + name + " isn't a function");
+
+    return Function(this, *var, id.value());
+}
+
+template<bool debug>
+std::vector<internal::Value> VM_t<debug>::mapCallback(internal::Callback& callback, const std::vector<internal::Value>& args)
+{
+    using namespace Ark::internal;
+
+    std::vector<Value> results;
+    results.reserve(args.size());
+    for (const Value& arg : args)
+    {
+        push(arg);
+        push(callback.m_function);
+        m_last_sym_loaded = static_cast<uint16_t>(m_state->m_symbols.size());
+
+        results.push_back(callFromHost(1, &callback.m_scope, "a callback failed"));
+    }
+    return results;
+}
+
+template<bool debug>
+internal::Value VM_t<debug>::callFromHost(uint16_t argc, internal::Scope_t* scope, const char* failure)
+{
+    using namespace Ark::internal;
+
+    std::size_t ip = m_ip;
+    std::size_t pp = m_pp;
+    // under the arguments and the function
+    std::size_t sp = m_sp - argc - 1;
+    std::size_t frames_count = m_frames.size();
+    // called by a builtin or a plugin during a run, instead of by the host between two runs
+    bool nested = m_running;
+
+    auto unwind = [&]() {
+        while (m_frames.size() > frames_count)
+            returnFromFuncCall();
+        m_sp = sp;
+        m_ip = ip;
+        m_pp = pp;
+    };
+
+    int out = 0;
+    try
+    {
+        call(argc, scope);
+        // builtins have already returned, functions run until they do
+        if (m_frames.size() > frames_count)
+            out = safeRun(/* untilFrameCount */ frames_count);
+    }
+    catch (const Ark::ExecutionCancelled&)
+    {
+        unwind();
+        // a run being cancelled stops by itself when it gets the exception, otherwise the VM must be
+        // usable again once the host got it
+        if (!nested)
+            m_interrupts.fetch_and(~InterruptCancel, std::memory_order_relaxed);
+        throw;
+    }
+    catch (...)
+    {
+        unwind();
+        throw;
+    }
+
+    if (out != 0)
+    {
+        // the error was displayed by the run
+        unwind();
+        throwVMError(failure);
+    }
+
+    Value result = (m_sp > sp) ? std::move(*pop()) : FFI::nil;
+    m_sp = sp;
+    m_ip = ip;
+    m_pp = pp;
+    return result;
+}
+
+template<bool debug>
+void VM_t<debug>::enableProfiler()
+{
+    if (!m_profiler)
+        m_profiler = std::make_unique<internal::Profiler>(m_state->m_pages.size());
+}
+
+template<bool debug>
+void VM_t<debug>::profileReport(std::ostream& os)
+{
+    if (m_profiler)
+        m_profiler->report(os, pageNames());
+}
+
+template<bool debug>
+void VM_t<debug>::startSampling(std::chrono::microseconds interval)
+{
+    stopSampling();
+    m_sampler = std::make_unique<internal::Sampler>([this] {
+        m_interrupts.fetch_or(InterruptSample, std::memory_order_relaxed);
+    }, interval);
+}
+
+template<bool debug>
+void VM_t<debug>::stopSampling()
+{
+    if (m_sampler)
+        m_sampler->stop();
+    // the thread is stopped, it can not ask for another sample
+    m_interrupts.fetch_and(~InterruptSample, std::memory_order_relaxed);
+}
+
+template<bool debug>
+void VM_t<debug>::writeFoldedStacks(std::ostream& os)
+{
+    if (m_sampler)
+        m_sampler->write(os, pageNames());
+}
+
+template<bool debug>
+std::vector<std::string> VM_t<debug>::pageNames()
+{
+    using namespace Ark::internal;
+
+    std::vector<std::string> names(m_state->m_pages.size());
+    names[0] = "(global scope)";
+    // names given by the compiler, if the bytecode has the debug information
+    for (std::size_t page=1; page < names.size(); ++page)
+        names[page] = m_state->pageName(static_cast<PageAddr_t>(page));
+
+    if (!m_locals.empty())
+    {
+        for (auto&& [id, value] : *m_locals[0])
+        {
+            PageAddr_t page;
+            if (value.valueType() == ValueType::PageAddr)
+                page = value.pageAddr();
+            else if (value.valueType() == ValueType::Closure)
+                page = value.closure().pageAddr();
+            else
+                continue;
+
+            if (page < names.size() && names[page].empty() && id < m_state->m_symbols.size())
+                names[page] = m_state->m_symbols[id];
+        }
+    }
+
+    for (std::size_t page=1; page < names.size(); ++page)
+    {
+        if (names[page].empty())
+            names[page] = "(anonymous function, page " + Ark::Utils::toString(page) + ")";
+    }
+    return names;
+}
+
 template<bool debug>
 internal::Value& VM_t<debug>::operator[](const std::string& name)
 {
     using namespace Ark::internal;
 
     // find id of object
-    auto it = std::find(m_state->m_symbols.begin(), m_state->m_symbols.end(), name);
-    if (it == m_state->m_symbols.end())
+    auto id = m_state->symbolId(name);
+    if (!id)
     {
         m__no_value = FFI::nil;
         return m__no_value;
     }
 
-    uint16_t id = static_cast<uint16_t>(std::distance(m_state->m_symbols.begin(), it));
-    Value* var = findNearestVariable(id);
+    Value* var = findNearestVariable(id.value());
     if (var != nullptr)
         return *var;
     else
@@ -104,6 +496,31 @@ internal::Value& VM_t<debug>::operator[](const std::string& name)
     }
 }
 
+template<bool debug>
+std::vector<std::pair<std::vector<uint8_t>, std::size_t>> VM_t<debug>::hottestOpcodeSequences(std::size_t length, std::size_t count) const
+{
+    std::vector<std::pair<std::vector<uint8_t>, std::size_t>> sequences;
+
+    for (auto&& [key, executed] : m_opcode_sequences)
+    {
+        if ((key >> 24) != length)
+            continue;
+
+        std::vector<uint8_t> opcodes;
+        for (std::size_t i=length; i > 0; --i)
+            opcodes.push_back(static_cast<uint8_t>((key >> (8 * (i - 1))) & 0xff));
+        sequences.emplace_back(std::move(opcodes), executed);
+    }
+
+    std::sort(sequences.begin(), sequences.end(), [](const auto& a, const auto& b) -> bool {
+        return a.second > b.second;
+    });
+    if (sequences.size() > count)
+        sequences.resize(count);
+
+    return sequences;
+}
+
 // ------------------------------------------
 //                 execution
 // ------------------------------------------
@@ -117,739 +534,1341 @@ int VM_t<debug>::run()
         Ark::logger.info("Starting at PP:{0}, IP:{1}"s, m_pp, m_ip);
     
     init();
+    m_suspended = false;
+    resetBudget();
     int out = safeRun();
 
-    // reset VM after each run
-    m_ip = 0;
-    m_pp = 0;
+    // reset VM after each run, unless it can be continued
+    if (out != Yielded)
+    {
+        m_ip = 0;
+        m_pp = 0;
+    }
 
     return out;
 }
 
 template<bool debug>
-int VM_t<debug>::safeRun(std::size_t untilFrameCount)
+int VM_t<debug>::continueRun()
+{
+    if (!m_suspended)
+        throwVMError("can not continue a run which wasn't stopped by its budget");
+
+    m_suspended = false;
+    resetBudget();
+    int out = safeRun();
+
+    if (out != Yielded)
+    {
+        m_ip = 0;
+        m_pp = 0;
+    }
+
+    return out;
+}
+
+template<bool debug>
+void VM_t<debug>::setBudget(std::size_t ticks)
+{
+    m_budget = ticks;
+}
+
+template<bool debug>
+void VM_t<debug>::setDeadline(std::chrono::steady_clock::time_point deadline)
+{
+    m_deadline = deadline;
+}
+
+template<bool debug>
+void VM_t<debug>::clearDeadline()
+{
+    m_deadline.reset();
+}
+
+template<bool debug>
+void VM_t<debug>::resetBudget()
+{
+    m_budget_left = (m_budget != 0) ? m_budget : NoLimit;
+    armBudget();
+}
+
+template<bool debug>
+void VM_t<debug>::armBudget()
+{
+    m_ticks_armed = m_deadline ? std::min(m_budget_left, DeadlineCheckInterval) : m_budget_left;
+    m_ticks_left = m_ticks_armed;
+}
+
+template<bool debug>
+bool VM_t<debug>::budgetExhausted()
+{
+    uint8_t interrupts = m_interrupts.load(std::memory_order_relaxed);
+    if (interrupts & InterruptCancel)
+        throw Ark::ExecutionCancelled();
+    if (interrupts & InterruptSample)
+    {
+        m_interrupts.fetch_and(~InterruptSample, std::memory_order_relaxed);
+        takeSample();
+    }
+
+    if (m_budget_left != NoLimit)
+        m_budget_left -= std::min(m_budget_left, m_ticks_armed - m_ticks_left);
+
+    if (m_budget_left == 0 || (m_deadline && std::chrono::steady_clock::now() >= m_deadline.value()))
+    {
+        // only the outermost run can yield, the nested ones (call(), resolve()) must give a result:
+        // check again at each tick until we are back in it
+        if (m_until_frame_count == 0)
+            return true;
+
+        m_ticks_armed = m_ticks_left = 1;
+        return false;
+    }
+
+    armBudget();
+    return false;
+}
+
+template<bool debug>
+void VM_t<debug>::takeSample()
+{
+    if (!m_sampler)
+        return;
+
+    m_sampled_stack.clear();
+    for (const internal::Frame& frame : m_frames)
+        m_sampled_stack.push_back(static_cast<internal::PageAddr_t>(frame.currentPageAddr()));
+    m_sampler->record(m_sampled_stack);
+}
+
+template<bool debug>
+template<bool profile>
+int VM_t<debug>::runLoop(std::size_t untilFrameCount)
 {
     using namespace Ark::internal;
+
+    // nested runs (from call() or resolve()) must not clobber the stop condition of
+    // the run which is calling them
+    std::size_t old_until_frame_count = m_until_frame_count;
+    bool old_running = m_running;
     m_until_frame_count = untilFrameCount;
 
+    // so that plugins can call .resolve(...) on the functions they were sent
+    ExecutionContext old_context = execution_context;
+    if constexpr (debug)
+        execution_context = ExecutionContext { nullptr, this };
+    else
+        execution_context = ExecutionContext { this, nullptr };
+
+    // indexed by value type, followed by the names of the NFT values
     static const Value types_to_str[] = {
         Value("List"), Value("Number"), Value("String"), Value("Function"),
-        Value("NFT"), Value("CProc"), Value("Closure"),
+        Value("NFT"), Value("CProc"), Value("Closure"), Value("UserType"), Value("Coroutine"),
         Value("Nil"), Value("Bool"), Value("Undefined")
     };
-    
+
+#if ARK_USE_COMPUTED_GOTO
+    // one label per opcode, unknown opcodes are rejected by State::configure
+    static const void* const opcode_targets[Instruction::LAST_INSTRUCTION + 1] = {
+        &&TARGET_NOP,
+        &&TARGET_LOAD_SYMBOL, &&TARGET_LOAD_CONST, &&TARGET_POP_JUMP_IF_TRUE, &&TARGET_STORE,
+        &&TARGET_LET, &&TARGET_POP_JUMP_IF_FALSE, &&TARGET_JUMP, &&TARGET_RET,
+        &&TARGET_HALT, &&TARGET_CALL, &&TARGET_CAPTURE, &&TARGET_BUILTIN,
+        &&TARGET_MUT, &&TARGET_DEL, &&TARGET_SAVE_ENV, &&TARGET_GET_FIELD,
+        &&TARGET_LOAD_LOCAL, &&TARGET_STORE_LOCAL, &&TARGET_LET_LOCAL, &&TARGET_MUT_LOCAL,
+        &&TARGET_TAIL_CALL,
+        // 0x16 - 0x1f: unused
+        &&unknown_instruction, &&unknown_instruction, &&unknown_instruction, &&unknown_instruction,
+        &&unknown_instruction, &&unknown_instruction, &&unknown_instruction, &&unknown_instruction,
+        &&unknown_instruction, &&unknown_instruction,
+        // operators
+        &&TARGET_ADD, &&TARGET_SUB, &&TARGET_MUL, &&TARGET_DIV,
+        &&TARGET_GT, &&TARGET_LT, &&TARGET_LE, &&TARGET_GE,
+        &&TARGET_NEQ, &&TARGET_EQ, &&TARGET_LEN, &&TARGET_EMPTY,
+        &&TARGET_FIRSTOF, &&TARGET_TAILOF, &&TARGET_HEADOF, &&TARGET_ISNIL,
+        &&TARGET_ASSERT, &&TARGET_TO_NUM, &&TARGET_TO_STR, &&TARGET_AT,
+        &&TARGET_AND_, &&TARGET_OR_, &&TARGET_MOD, &&TARGET_TYPE,
+        &&TARGET_HASFIELD, &&TARGET_NOT, &&TARGET_YIELD, &&TARGET_RESUME,
+        // 0x3c - 0x3f: unused
+        &&unknown_instruction, &&unknown_instruction, &&unknown_instruction, &&unknown_instruction,
+        // superinstructions
+        &&TARGET_INCREMENT, &&TARGET_DECREMENT, &&TARGET_INCREMENT_LOCAL, &&TARGET_DECREMENT_LOCAL,
+        &&TARGET_ADD_CONST, &&TARGET_SUB_CONST,
+        &&TARGET_GT_JUMP_IF_FALSE, &&TARGET_LT_JUMP_IF_FALSE, &&TARGET_LE_JUMP_IF_FALSE,
+        &&TARGET_GE_JUMP_IF_FALSE, &&TARGET_NEQ_JUMP_IF_FALSE, &&TARGET_EQ_JUMP_IF_FALSE,
+        &&TARGET_CALL_BUILTIN
+    };
+
+    #define TARGET(op) TARGET_##op:
+    #define DISPATCH_GOTO() goto *opcode_targets[inst]
+#else
+    #define TARGET(op) case Instruction::op:
+    #define DISPATCH_GOTO() goto dispatch_opcode
+#endif
+
+    // m_ip always points to the next instruction once the current one has been fetched
+    #define FETCH_INSTRUCTION()                                                                                 \
+        do {                                                                                                    \
+            if constexpr (debug)                                                                                \
+            {                                                                                                   \
+                if (m_pp >= m_state->m_pages.size())                                                            \
+                    throwVMError("page pointer has gone too far (" + Ark::Utils::toString(m_pp) + ")");         \
+                if (m_ip >= m_state->m_pages[m_pp].size())                                                      \
+                    throwVMError("instruction pointer has gone too far (" + Ark::Utils::toString(m_ip) + ")");  \
+            }                                                                                                   \
+            const Word& word = m_state->m_pages[m_pp][m_ip++];                                                  \
+            inst = word.opcode;                                                                                 \
+            arg = word.data;                                                                                    \
+            if constexpr (debug)                                                                                \
+                countOpcode(inst);                                                                              \
+            if constexpr (profile)                                                                              \
+                m_profiler->instruction(inst, m_pp);                                                            \
+        } while (false)
+
+    // second argument of an instruction, stored in the word following it
+    #define FETCH_EXTENSION() (m_state->m_pages[m_pp][m_ip++].data)
+
+    // a tick of the execution budget, at backward jumps and calls, once the VM is ready to
+    // execute the next instruction
+    #define TICK()                                                                                              \
+        do {                                                                                                    \
+            if ((--m_ticks_left == 0 || m_interrupts.load(std::memory_order_relaxed)) && budgetExhausted())       \
+                goto yielded;                                                                                   \
+        } while (false)
+
+    // every handler jumps by itself to the next one, so that each of them gets its own
+    // indirect branch (and its own entry in the branch predictor)
+    #define DISPATCH()           \
+        do {                     \
+            FETCH_INSTRUCTION(); \
+            DISPATCH_GOTO();     \
+        } while (false)
+
     try {
         m_running = true;
-        while (m_running && m_frames.size() > m_until_frame_count)
+        if constexpr (profile)
         {
-            if constexpr (debug)
+            m_profiler->resize(m_state->m_pages.size());
+            syncProfiler();
+        }
+        if (m_frames.size() <= m_until_frame_count)
+            goto finished;
+
+        uint8_t inst;
+        uint16_t arg;
+        FETCH_INSTRUCTION();
+        DISPATCH_GOTO();
+
+#if !ARK_USE_COMPUTED_GOTO
+    dispatch_opcode:
+#endif
+        switch (inst)
+        {
+            TARGET(NOP)
             {
-                if (m_pp >= m_state->m_pages.size())
-                    throwVMError("page pointer has gone too far (" + Ark::Utils::toString(m_pp) + ")");
-                if (m_ip >= m_state->m_pages[m_pp].size())
-                    throwVMError("instruction pointer has gone too far (" + Ark::Utils::toString(m_ip) + ")");
+                if constexpr (debug)
+                    Ark::logger.info("NOP PP:{0}, IP:{1}"s, m_pp, m_ip);
+                DISPATCH();
             }
 
-            // get current instruction
-            uint8_t inst = m_state->m_pages[m_pp][m_ip];
-
-            // and it's time to du-du-du-du-duel!
-            if (inst == Instruction::NOP)
+            TARGET(LOAD_SYMBOL)
             {
+                /*
+                    Argument: symbol id (two bytes, big endian)
+                    Job: Load a symbol from its id onto the stack
+                */
+
+                uint16_t id = arg;
+
                 if constexpr (debug)
-                    Ark::logger.info("NOP PP:{0}, IP:{1}"s, m_pp, m_ip);
-            }
-            else if (Instruction::FIRST_COMMAND <= inst && inst <= Instruction::LAST_COMMAND)
-                switch (inst)
+                    Ark::logger.info("LOAD_SYMBOL ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+
+                Value* var = findNearestVariable(id);
+                if (var != nullptr)
                 {
-                case Instruction::LOAD_SYMBOL:
+                    push(*var);
+                    m_last_sym_loaded = id;
+                    DISPATCH();
+                }
+
+                throwVMError("couldn't find symbol to load: " + m_state->m_symbols[id]);
+            }
+
+            TARGET(LOAD_CONST)
+            {
+                /*
+                    Argument: constant id (two bytes, big endian)
+                    Job: Load a constant from its id onto the stack. Should check for a saved environment
+                            and push a Closure with the page address + environment instead of the constant
+                */
+
+                uint16_t id = arg;
+
+                if constexpr (debug)
+                    Ark::logger.info("LOAD_CONST ({0}) PP:{1}, IP:{2}"s, m_state->m_constants[id], m_pp, m_ip);
+
+                if (m_saved_scope && m_state->m_constants[id].valueType() == ValueType::PageAddr)
                 {
-                    /*
-                        Argument: symbol id (two bytes, big endian)
-                        Job: Load a symbol from its id onto the stack
-                    */
-                    
-                    ++m_ip;
-                    uint16_t id = readNumber();
+                    push(Value(Closure(m_saved_scope.value(), m_state->m_constants[id].pageAddr())));
+                    m_saved_scope.reset();
+                }
+                else
+                    push(m_state->m_constants[id]);
+                DISPATCH();
+            }
 
-                    if constexpr (debug)
-                        Ark::logger.info("LOAD_SYMBOL ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+            TARGET(POP_JUMP_IF_TRUE)
+            {
+                /*
+                    Argument: absolute address to jump to (two bytes, big endian, decoded to an instruction index)
+                    Job: Jump to the provided address if the last value on the stack was equal to true.
+                            Remove the value from the stack no matter what it is
+                */
 
-                    Value* var = findNearestVariable(id);
-                    if (var != nullptr)
-                    {
-                        push(*var);
-                        m_last_sym_loaded = id;
-                        break;
-                    }
+                uint16_t addr = arg;
 
-                    throwVMError("couldn't find symbol to load: " + m_state->m_symbols[id]);
-                    break;
+                if constexpr (debug)
+                    Ark::logger.info("POP_JUMP_IF_TRUE ({0}) PP:{1}, IP:{2}"s, addr, m_pp, m_ip);
+
+                if (*pop() == FFI::trueSym)
+                    m_ip = addr;
+                DISPATCH();
+            }
+
+            TARGET(STORE)
+            {
+                /*
+                    Argument: symbol id (two bytes, big endian)
+                    Job: Take the value on top of the stack and put it inside a variable named following
+                            the symbol id (cf symbols table), in the nearest scope. Raise an error if it
+                            couldn't find a scope where the variable exists
+                */
+
+                uint16_t id = arg;
+
+                if constexpr (debug)
+                    Ark::logger.info("STORE ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+
+                Value* var = findNearestVariable(id);
+                if (var != nullptr)
+                {
+                    if (var->m_const)
+                        throwVMError("can not modify a constant: " + m_state->m_symbols[id]);
+                    *var = *pop();
+                    DISPATCH();
                 }
-                
-                case Instruction::LOAD_CONST:
+
+                throwVMError("couldn't find symbol: " + m_state->m_symbols[id]);
+            }
+
+            TARGET(LET)
+            {
+                /*
+                    Argument: symbol id (two bytes, big endian)
+                    Job: Take the value on top of the stack and create a constant in the current scope, named
+                            following the given symbol id (cf symbols table)
+                */
+
+                uint16_t id = arg;
+
+                if constexpr (debug)
+                    Ark::logger.info("LET ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+
+                // check if we are redefining a variable
+                Value* var = getVariableInScope(id);
+                if (var != nullptr && *var != FFI::undefined)
+                    throwVMError("can not use 'let' to redefine the variable " + m_state->m_symbols[id]);
+
+                registerVariable(id, *pop()).m_const = true;
+                DISPATCH();
+            }
+
+            TARGET(POP_JUMP_IF_FALSE)
+            {
+                /*
+                    Argument: absolute address to jump to (two bytes, big endian, decoded to an instruction index)
+                    Job: Jump to the provided address if the last value on the stack was equal to false. Remove
+                            the value from the stack no matter what it is
+                */
+
+                uint16_t addr = arg;
+
+                if constexpr (debug)
+                    Ark::logger.info("POP_JUMP_IF_FALSE ({0}) PP:{1}, IP:{2}"s, addr, m_pp, m_ip);
+
+                if (*pop() == FFI::falseSym)
+                    m_ip = addr;
+                DISPATCH();
+            }
+
+            TARGET(JUMP)
+            {
+                /*
+                    Argument: absolute address to jump to (two bytes, big endian, decoded to an instruction index)
+                    Job: Jump to the provided address
+                */
+
+                uint16_t addr = arg;
+
+                if constexpr (debug)
+                    Ark::logger.info("JUMP ({0}) PP:{1}, IP:{2}"s, addr, m_pp, m_ip);
+
+                // loops jump back to their condition
+                bool backward = addr < m_ip;
+                m_ip = addr;
+                if (backward)
+                    TICK();
+                DISPATCH();
+            }
+
+            TARGET(RET)
+            {
+                /*
+                    Argument: none
+                    Job: If in a code segment other than the main one, quit it, and push the value on top of
+                            the stack to the new stack ; should as well delete the current environment.
+                            Otherwise, acts as a `HALT`
+                */
+
+                if constexpr (debug)
+                    Ark::logger.info("RET PP:{0}, IP:{1}"s, m_pp, m_ip);
+
+                // check if we should halt the VM
+                if (m_pp == 0)
                 {
-                    /*
-                        Argument: constant id (two bytes, big endian)
-                        Job: Load a constant from its id onto the stack. Should check for a saved environment
-                                and push a Closure with the page address + environment instead of the constant
-                    */
+                    m_running = false;
+                    goto finished;
+                }
 
-                    ++m_ip;
-                    uint16_t id = readNumber();
+                m_pp = m_frames.back().callerPageAddr();
+                m_ip = m_frames.back().callerAddr();
 
-                    if constexpr (debug)
-                        Ark::logger.info("LOAD_CONST ({0}) PP:{1}, IP:{2}"s, m_state->m_constants[id], m_pp, m_ip);
-                    
-                    if (m_saved_scope && m_state->m_constants[id].valueType() == ValueType::PageAddr)
-                    {
-                        push(Value(Closure(m_saved_scope.value(), m_state->m_constants[id].pageAddr())));
-                        m_saved_scope.reset();
-                    }
-                    else
-                        push(m_state->m_constants[id]);
-                    break;
+                if (stackSize() != 0)
+                {
+                    Value return_value = std::move(*pop());
+                    returnFromFuncCall();
+                    // push value as the return value of a function to the current stack
+                    push(std::move(return_value));
                 }
-                
-                case Instruction::POP_JUMP_IF_TRUE:
+                else
                 {
-                    /*
-                        Argument: absolute address to jump to (two bytes, big endian)
-                        Job: Jump to the provided address if the last value on the stack was equal to true.
-                                Remove the value from the stack no matter what it is
-                    */
+                    returnFromFuncCall();
+                    push(FFI::nil);
+                }
 
-                    ++m_ip;
-                    int16_t addr = static_cast<int16_t>(readNumber());
+                // the coroutine being run returned
+                if (!m_coroutines.empty() && m_frames.size() == m_coroutines.back().coroutine_ref().m_frames_base)
+                    finishCoroutine();
+                if constexpr (profile)
+                    syncProfiler();
 
-                    if constexpr (debug)
-                        Ark::logger.info("POP_JUMP_IF_TRUE ({0}) PP:{1}, IP:{2}"s, addr, m_pp, m_ip);
+                // returnFromFuncCall tells us if we reached the frame we were asked to stop at
+                if (!m_running)
+                    goto finished;
+                DISPATCH();
+            }
 
-                    if (*pop() == FFI::trueSym)
-                        m_ip = addr - 1;  // because we are doing a ++m_ip right after this
-                    break;
+            TARGET(HALT)
+            {
+                m_running = false;
+                goto finished;
+            }
+
+            TARGET(CALL)
+            {
+                if constexpr (profile)
+                    m_profiler->callSite(m_pp, m_ip - 1);
+                call(arg);
+                if constexpr (profile)
+                    syncProfiler();
+                TICK();
+                DISPATCH();
+            }
+
+            TARGET(TAIL_CALL)
+            {
+                if constexpr (profile)
+                {
+                    m_profiler->callSite(m_pp, m_ip - 1);
+                    // a plain function takes the frame of its caller, which is done
+                    if (m_pp != 0 && m_stack[m_sp - 1].valueType() == ValueType::PageAddr)
+                        m_profiler->leave();
+                }
+                tailCall(arg);
+                if constexpr (profile)
+                    syncProfiler();
+                TICK();
+                DISPATCH();
+            }
+
+            TARGET(CAPTURE)
+            {
+                /*
+                    Argument: symbol id (two bytes, big endian)
+                    Job: Used to tell the Virtual Machine to capture the variable from the current environment.
+                        Main goal is to be able to handle closures, which need to save the environment in which
+                        they were created
+                */
+
+                uint16_t id = arg;
+
+                if constexpr (debug)
+                    Ark::logger.info("CAPTURE ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+
+                if (!m_saved_scope)
+                {
+                    // the captures of a closure follow each other, its environment only holds them
+                    std::size_t count = 1;
+                    while (m_state->m_pages[m_pp][m_ip + count - 1].opcode == Instruction::CAPTURE)
+                        count++;
+
+                    m_saved_scope = std::make_shared<Scope>();
+                    m_saved_scope.value()->reserve(count);
+                    m_saved_scope.value()->setOwner(m_worker_run);
+                    trackScope(m_saved_scope.value());
                 }
-                
-                case Instruction::STORE:
+
+                Value* var = getVariableInScope(id);
+                m_saved_scope.value()->set(id, var != nullptr ? *var : FFI::undefined);
+                DISPATCH();
+            }
+
+            TARGET(BUILTIN)
+            {
+                /*
+                    Argument: id of builtin (two bytes, big endian)
+                    Job: Push the builtin function object on the stack
+                */
+
+                uint16_t id = arg;
+
+                if constexpr (debug)
+                    Ark::logger.info("BUILTIN ({0}) PP:{1}, IP:{2}"s, FFI::builtins[id].first, m_pp, m_ip);
+
+                push(FFI::builtins[id].second);
+                DISPATCH();
+            }
+
+            TARGET(MUT)
+            {
+                /*
+                    Argument: symbol id (two bytes, big endian)
+                    Job: Take the value on top of the stack and create a variable in the current scope,
+                        named following the given symbol id (cf symbols table)
+                */
+
+                uint16_t id = arg;
+
+                if constexpr (debug)
+                    Ark::logger.info("MUT ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+
+                registerVariable(id, *pop()).m_const = false;
+                DISPATCH();
+            }
+
+            TARGET(DEL)
+            {
+                /*
+                    Argument: symbol id (two bytes, big endian)
+                    Job: Remove a variable/constant named following the given symbol id (cf symbols table)
+                */
+
+                uint16_t id = arg;
+
+                if constexpr (debug)
+                    Ark::logger.info("DEL ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+
+                Value* var = findNearestVariable(id);
+                if (var != nullptr)
                 {
-                    /*
-                        Argument: symbol id (two bytes, big endian)
-                        Job: Take the value on top of the stack and put it inside a variable named following
-                                the symbol id (cf symbols table), in the nearest scope. Raise an error if it
-                                couldn't find a scope where the variable exists
-                    */
-                    
-                    ++m_ip;
-                    uint16_t id = readNumber();
+                    *var = FFI::undefined;
+                    DISPATCH();
+                }
+
+                throwVMError("couldn't find symbol: " + m_state->m_symbols[id]);
+            }
 
+            TARGET(SAVE_ENV)
+            {
+                /*
+                    Argument: none
+                    Job: Save the current environment, useful for quoted code
+                */
+                m_saved_scope = m_locals.back();
+                if (m_worker_run != 0)
+                    m_saved_scope.value()->setOwner(m_worker_run);
+                DISPATCH();
+            }
+
+            TARGET(GET_FIELD)
+            {
+                /*
+                    Argument: symbol id (two bytes, big endian), slot of the field in the closure environment if
+                        the compiler could find it (two bytes, big endian)
+                    Job: Used to read the field named following the given symbol id (cf symbols table) of a `Closure`
+                        stored in TS. Pop TS and push the value of field read on the stack
+                */
+
+                uint16_t id = arg;
+                uint16_t slot = FETCH_EXTENSION();
+
+                if constexpr (debug)
+                    Ark::logger.info("GET_FIELD ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+
+                Value* var = pop();
+                if (var->valueType() != ValueType::Closure)
+                    throwVMError("variable `" + m_state->m_symbols[m_last_sym_loaded] + "' isn't a closure, can not get the field `" + m_state->m_symbols[id] + "' from it");
+
+                const Scope_t& env_ptr = closureScope(var->closure_ref());
+                Scope& env = *env_ptr;
+                // the slot is only a hint: closures capturing the field at another place have to look for it
+                Value* field = (slot < env.size() && env.idOf(slot) == id) ? &env.slot(slot) : env.find(id);
+                if (field != nullptr && *field != FFI::undefined)
+                {
                     if constexpr (debug)
-                        Ark::logger.info("STORE ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+                        Ark::logger.data("Pushing closure field:", *field);
 
-                    Value* var = findNearestVariable(id);
-                    if (var != nullptr)
+                    // check for CALL instruction. Only functions get a scope of their own, popped
+                    // when they return, thus the current scope must stay the last one otherwise
+                    if (m_ip < m_state->m_pages[m_pp].size() && m_state->m_pages[m_pp][m_ip].opcode == Instruction::CALL &&
+                        (field->valueType() == ValueType::PageAddr || field->valueType() == ValueType::Closure))
                     {
-                        if (var->m_const)
-                            throwVMError("can not modify a constant: " + m_state->m_symbols[id]);
-                        *var = *pop();
-                        break;
+                        m_locals.push_back(env_ptr);
+                        m_frames.back().incScopeCountToDelete();
                     }
 
-                    throwVMError("couldn't find symbol: " + m_state->m_symbols[id]);
-                    break;
+                    push(*field);
+                    DISPATCH();
                 }
-                
-                case Instruction::LET:
+
+                throwVMError("couldn't find symbol in closure enviroment: " + m_state->m_symbols[id]);
+            }
+
+            TARGET(LOAD_LOCAL)
+            {
+                /*
+                    Argument: slot of the variable in the current scope (two bytes, big endian)
+                    Job: Load a local variable onto the stack. If it wasn't defined yet, look for it
+                            in the enclosing scopes, as LOAD_SYMBOL would
+                */
+
+                Value& local = m_locals.back()->slot(arg);
+                uint16_t id = m_locals.back()->idOf(arg);
+
+                if constexpr (debug)
+                    Ark::logger.info("LOAD_LOCAL ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+
+                Value* var = (local != FFI::undefined) ? &local : findNearestVariable(id);
+                if (var != nullptr)
                 {
-                    /*
-                        Argument: symbol id (two bytes, big endian)
-                        Job: Take the value on top of the stack and create a constant in the current scope, named
-                                following the given symbol id (cf symbols table)
-                    */
+                    push(*var);
+                    m_last_sym_loaded = id;
+                    DISPATCH();
+                }
+
+                throwVMError("couldn't find symbol to load: " + m_state->m_symbols[id]);
+            }
 
-                    ++m_ip;
-                    uint16_t id = readNumber();
+            TARGET(STORE_LOCAL)
+            {
+                /*
+                    Argument: slot of the variable in the current scope (two bytes, big endian)
+                    Job: Take the value on top of the stack and put it inside a local variable. If it
+                            wasn't defined yet, look for it in the enclosing scopes, as STORE would
+                */
 
-                    if constexpr (debug)
-                        Ark::logger.info("LET ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
-                    
-                    // check if we are redefining a variable
-                    if (getVariableInScope(id) != FFI::undefined)
-                        throwVMError("can not use 'let' to redefine the variable " + m_state->m_symbols[id]);
+                Value& local = m_locals.back()->slot(arg);
+                uint16_t id = m_locals.back()->idOf(arg);
 
-                    registerVariable(id, *pop()).m_const = true;
-                    break;
+                if constexpr (debug)
+                    Ark::logger.info("STORE_LOCAL ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+
+                Value* var = (local != FFI::undefined) ? &local : findNearestVariable(id);
+                if (var != nullptr)
+                {
+                    if (var->m_const)
+                        throwVMError("can not modify a constant: " + m_state->m_symbols[id]);
+                    *var = *pop();
+                    DISPATCH();
+                }
+
+                throwVMError("couldn't find symbol: " + m_state->m_symbols[id]);
+            }
+
+            TARGET(LET_LOCAL)
+            {
+                /*
+                    Argument: slot of the variable in the current scope (two bytes, big endian)
+                    Job: Take the value on top of the stack and create a local constant
+                */
+
+                Value& local = m_locals.back()->slot(arg);
+
+                if constexpr (debug)
+                    Ark::logger.info("LET_LOCAL ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[m_locals.back()->idOf(arg)], m_pp, m_ip);
+
+                // check if we are redefining a variable
+                if (local != FFI::undefined)
+                    throwVMError("can not use 'let' to redefine the variable " + m_state->m_symbols[m_locals.back()->idOf(arg)]);
+
+                local = std::move(*pop());
+                local.m_const = true;
+                DISPATCH();
+            }
+
+            TARGET(MUT_LOCAL)
+            {
+                /*
+                    Argument: slot of the variable in the current scope (two bytes, big endian)
+                    Job: Take the value on top of the stack and create a local variable
+                */
+
+                Value& local = m_locals.back()->slot(arg);
+
+                if constexpr (debug)
+                    Ark::logger.info("MUT_LOCAL ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[m_locals.back()->idOf(arg)], m_pp, m_ip);
+
+                local = std::move(*pop());
+                local.m_const = false;
+                DISPATCH();
+            }
+
+            TARGET(ADD)
+            {
+                Value *b = pop(), *a = pop();
+                if (a->valueType() == ValueType::Number)
+                {
+                    if (b->valueType() != ValueType::Number)
+                        throw Ark::TypeError("Arguments of + should have the same type");
+
+                    push(addNumbers(*a, *b));
+                    DISPATCH();
                 }
-                
-                case Instruction::POP_JUMP_IF_FALSE:
+                else if (a->valueType() == ValueType::String)
                 {
-                    /*
-                        Argument: absolute address to jump to (two bytes, big endian)
-                        Job: Jump to the provided address if the last value on the stack was equal to false. Remove
-                                the value from the stack no matter what it is
-                    */
+                    if (b->valueType() != ValueType::String)
+                        throw Ark::TypeError("Arguments of + should have the same type");
 
-                    ++m_ip;
-                    int16_t addr = static_cast<int16_t>(readNumber());
+                    push(Value(a->string() + b->string()));
+                    DISPATCH();
+                }
+                throw Ark::TypeError("Arguments of + should be Numbers or Strings");
+            }
 
-                    if constexpr (debug)
-                        Ark::logger.info("POP_JUMP_IF_FALSE ({0}) PP:{1}, IP:{2}"s, addr, m_pp, m_ip);
+            TARGET(SUB)
+            {
+                Value *b = pop(), *a = pop();
+                if (a->valueType() != ValueType::Number)
+                    throw Ark::TypeError("Arguments of - should be Numbers");
+                if (b->valueType() != ValueType::Number)
+                    throw Ark::TypeError("Arguments of - should be Numbers");
+
+                push(subNumbers(*a, *b));
+                DISPATCH();
+            }
 
-                    if (*pop() == FFI::falseSym)
-                        m_ip = addr - 1;  // because we are doing a ++m_ip right after this
-                    break;
+            TARGET(MUL)
+            {
+                Value *b = pop(), *a = pop();
+                if (a->valueType() != ValueType::Number)
+                    throw Ark::TypeError("Arguments of * should be Numbers");
+                if (b->valueType() != ValueType::Number)
+                    throw Ark::TypeError("Arguments of * should be Numbers");
+
+                push(mulNumbers(*a, *b));
+                DISPATCH();
+            }
+
+            TARGET(DIV)
+            {
+                Value *b = pop(), *a = pop();
+                if (a->valueType() != ValueType::Number)
+                    throw Ark::TypeError("Arguments of / should be Numbers");
+                if (b->valueType() != ValueType::Number)
+                    throw Ark::TypeError("Arguments of / should be Numbers");
+
+                auto d = b->number();
+                if (d == 0)
+                    throw Ark::ZeroDivisionError();
+
+                push(Value(a->number() / d));
+                DISPATCH();
+            }
+
+            TARGET(GT)
+            {
+                Value *b = pop(), *a = pop();
+                push((!(*a == *b) && !(*a < *b)) ? FFI::trueSym : FFI::falseSym);
+                DISPATCH();
+            }
+
+            TARGET(LT)
+            {
+                Value *b = pop(), *a = pop();
+                push((*a < *b) ? FFI::trueSym : FFI::falseSym);
+                DISPATCH();
+            }
+
+            TARGET(LE)
+            {
+                Value *b = pop(), *a = pop();
+                push(((*a < *b) || (*a == *b)) ? FFI::trueSym : FFI::falseSym);
+                DISPATCH();
+            }
+
+            TARGET(GE)
+            {
+                Value *b = pop(), *a = pop();
+                push(!(*a < *b) ? FFI::trueSym : FFI::falseSym);
+                DISPATCH();
+            }
+
+            TARGET(NEQ)
+            {
+                Value *b = pop(), *a = pop();
+                push((*a != *b) ? FFI::trueSym : FFI::falseSym);
+                DISPATCH();
+            }
+
+            TARGET(EQ)
+            {
+                Value *b = pop(), *a = pop();
+                push((*a == *b) ? FFI::trueSym : FFI::falseSym);
+                DISPATCH();
+            }
+
+            TARGET(LEN)
+            {
+                Value *a = pop();
+                if (a->valueType() == ValueType::List)
+                {
+                    push(Value(static_cast<int>(a->const_list().size())));
+                    DISPATCH();
                 }
-                
-                case Instruction::JUMP:
+                if (a->valueType() == ValueType::String)
                 {
-                    /*
-                        Argument: absolute address to jump to (two byte, big endian)
-                        Job: Jump to the provided address
-                    */
+                    push(Value(static_cast<int>(a->string().size())));
+                    DISPATCH();
+                }
 
-                    ++m_ip;
-                    int16_t addr = static_cast<int16_t>(readNumber());
+                throw Ark::TypeError("Argument of len must be a list or a String");
+            }
 
-                    if constexpr (debug)
-                        Ark::logger.info("JUMP ({0}) PP:{1}, IP:{2}"s, addr, m_pp, m_ip);
+            TARGET(EMPTY)
+            {
+                Value* a = pop();
+                if (a->valueType() == ValueType::List)
+                    push((a->const_list().size() == 0) ? FFI::trueSym : FFI::falseSym);
+                else if (a->valueType() == ValueType::String)
+                    push((a->string().size() == 0) ? FFI::trueSym : FFI::falseSym);
+                else
+                    throw Ark::TypeError("Argument of empty? must be a list or a String");
 
-                    m_ip = addr - 1;  // because we are doing a ++m_ip right after this
-                    break;
+                DISPATCH();
+            }
+
+            TARGET(FIRSTOF)
+            {
+                Value a = *pop();
+                if (a.valueType() == ValueType::List)
+                    push(a.const_list().size() > 0 ? (a.const_list())[0] : FFI::nil);
+                else if (a.valueType() == ValueType::String)
+                    push(a.string().size() > 0 ? Value(std::string(1, (a.string())[0])) : FFI::nil);
+                else
+                    throw Ark::TypeError("Argument of firstOf must be a list");
+
+                DISPATCH();
+            }
+
+            TARGET(TAILOF)
+            {
+                Value* a = pop();
+                if (a->valueType() == ValueType::List)
+                {
+                    if (a->const_list().size() < 2)
+                    {
+                        push(FFI::nil);
+                        DISPATCH();
+                    }
+
+                    a->list().erase(a->list().begin());
+                    push(*a);
                 }
-                
-                case Instruction::RET:
+                else if (a->valueType() == ValueType::String)
                 {
-                    /*
-                        Argument: none
-                        Job: If in a code segment other than the main one, quit it, and push the value on top of
-                                the stack to the new stack ; should as well delete the current environment.
-                                Otherwise, acts as a `HALT`
-                    */
+                    if (a->string().size() < 2)
+                    {
+                        push(FFI::nil);
+                        DISPATCH();
+                    }
 
-                    if constexpr (debug)
-                        Ark::logger.info("RET PP:{0}, IP:{1}"s, m_pp, m_ip);
-                    
-                    // check if we should halt the VM
-                    if (m_pp == 0)
+                    a->string_ref().erase(a->string_ref().begin());
+                    push(*a);
+                }
+                else
+                    throw Ark::TypeError("Argument of tailOf must be a list or a String");
+
+                DISPATCH();
+            }
+
+            TARGET(HEADOF)
+            {
+                Value* a = pop();
+                if (a->valueType() == ValueType::List)
+                {
+                    if (a->const_list().size() < 2)
+                    {
+                        push(FFI::nil);
+                        DISPATCH();
+                    }
+
+                    a->list().pop_back();
+                    push(*a);
+                }
+                else if (a->valueType() == ValueType::String)
+                {
+                    if (a->string().size() < 2)
                     {
-                        m_running = false;
-                        break;
+                        push(FFI::nil);
+                        DISPATCH();
                     }
 
-                    // save pp
-                    PageAddr_t old_pp = static_cast<PageAddr_t>(m_pp);
-                    m_pp = m_frames.back().callerPageAddr();
-                    m_ip = m_frames.back().callerAddr();
-                    
-                    if (m_frames.back().stackSize() != 0)
-                    {
-                        Value return_value = *pop();
-                        returnFromFuncCall();
-                        // push value as the return value of a function to the current stack
-                        push(return_value);
-                    }
-                    else
-                    {
-                        returnFromFuncCall();
-                        push(FFI::nil);
-                    }
-                    break;
-                }
-                
-                case Instruction::HALT:
-                    m_running = false;
-                    break;
-                
-                case Instruction::CALL:
-                    call();
-                    break;
-                
-                case Instruction::CAPTURE:
+                    a->string_ref().pop_back();
+                    push(*a);
+                }
+                else
+                    throw Ark::TypeError("Argument of headOf must be a list or a String");
+
+                DISPATCH();
+            }
+
+            TARGET(ISNIL)
+            {
+                push((*pop() == FFI::nil) ? FFI::trueSym : FFI::falseSym);
+                DISPATCH();
+            }
+
+            TARGET(ASSERT)
+            {
+                Value *b = pop(), *a = pop();
+                if (*a == FFI::falseSym)
+                {
+                    if (b->valueType() != ValueType::String)
+                        throw Ark::TypeError("Second argument of assert must be a String");
+
+                    throw Ark::AssertionFailed(b->string());
+                }
+                DISPATCH();
+            }
+
+            TARGET(TO_NUM)
+            {
+                Value* a = pop();
+                if (a->valueType() != ValueType::String)
+                    throw Ark::TypeError("Argument of toNumber must be a String");
+
+                if (Utils::isDouble(a->string()))
+                    push(integralOrDouble(std::stod(a->string().c_str())));
+                else
+                    push(FFI::nil);
+                DISPATCH();
+            }
+
+            TARGET(TO_STR)
+            {
+                std::stringstream ss;
+                ss << (*pop());
+                push(Value(ss.str()));
+                DISPATCH();
+            }
+
+            TARGET(AT)
+            {
+                Value *b = pop(), *a = pop();
+                if (b->valueType() != ValueType::Number)
+                    throw Ark::TypeError("Argument 2 of @ should be a Number");
+
+                long index = b->isInteger() ? static_cast<long>(b->integer()) : static_cast<long>(b->number());
+                if (a->valueType() == ValueType::List)
+                    push(a->const_list()[index]);
+                else if (a->valueType() == ValueType::String)
+                    push(Value(std::string(1, a->string()[index])));
+                else
+                    throw Ark::TypeError("Argument 1 of @ should be a List or a String");
+                DISPATCH();
+            }
+
+            TARGET(AND_)
+            {
+                Value *a = pop(), *b = pop();
+                push((*a == FFI::trueSym && *b == FFI::trueSym) ? FFI::trueSym : FFI::falseSym);
+                DISPATCH();
+            }
+
+            TARGET(OR_)
+            {
+                Value *a = pop(), *b = pop();
+                push((*b == FFI::trueSym || *a == FFI::trueSym) ? FFI::trueSym : FFI::falseSym);
+                DISPATCH();
+            }
+
+            TARGET(MOD)
+            {
+                Value *b = pop(), *a = pop();
+                if (a->valueType() != ValueType::Number)
+                    throw Ark::TypeError("Arguments of mod should be Numbers");
+                if (b->valueType() != ValueType::Number)
+                    throw Ark::TypeError("Arguments of mod should be Numbers");
+
+                // x mod 0 gives NaN, like with doubles, and x mod -1 is the only one which can overflow
+                if (a->isInteger() && b->isInteger() && b->integer() != 0)
+                    push(Value(b->integer() == -1 ? static_cast<int64_t>(0) : a->integer() % b->integer()));
+                else
+                    push(Value(std::fmod(a->number(), b->number())));
+                DISPATCH();
+            }
+
+            TARGET(TYPE)
+            {
+                Value *a = pop();
+                if (a->valueType() != ValueType::NFT)
+                    push(types_to_str[static_cast<unsigned>(a->valueType())]);
+                else if (a->nft() == NFT::True || a->nft() == NFT::False)
+                    push(types_to_str[10]);
+                else if (a->nft() == NFT::Nil)
+                    push(types_to_str[9]);
+                else
+                    push(types_to_str[11]);
+                DISPATCH();
+            }
+
+            TARGET(HASFIELD)
+            {
+                Value *field = pop(), *closure = pop();
+                if (closure->valueType() != ValueType::Closure)
+                    throw Ark::TypeError("Argument no 1 of hasField should be a Closure");
+                if (field->valueType() != ValueType::String)
+                    throw Ark::TypeError("Argument no 2 of hasField should be a String");
+
+                auto id = m_state->symbolId(field->string());
+                if (!id)
                 {
-                    /*
-                        Argument: symbol id (two bytes, big endian)
-                        Job: Used to tell the Virtual Machine to capture the variable from the current environment.
-                            Main goal is to be able to handle closures, which need to save the environment in which
-                            they were created
-                    */
+                    push(FFI::falseSym);
+                    DISPATCH();
+                }
 
-                    ++m_ip;
-                    uint16_t id = readNumber();
+                Value* var = closureScope(closure->closure_ref())->find(id.value());
+                if (var != nullptr && *var != FFI::undefined)
+                    push(FFI::trueSym);
+                else
+                    push(FFI::falseSym);
 
-                    if constexpr (debug)
-                        Ark::logger.info("CAPTURE ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+                DISPATCH();
+            }
 
-                    if (!m_saved_scope)
-                    {
-                        m_saved_scope = std::make_shared<std::vector<Value>>(
-                            m_state->m_symbols.size(), internal::FFI::undefined
-                        );
-                    }
-                    (*m_saved_scope.value())[id] = getVariableInScope(id);
-                    break;
-                }
-                
-                case Instruction::BUILTIN:
-                {
-                    /*
-                        Argument: id of builtin (two bytes, big endian)
-                        Job: Push the builtin function object on the stack
-                    */
+            TARGET(NOT)
+            {
+                bool a = !(*pop());
+                if (a)
+                    push(FFI::trueSym);
+                else
+                    push(FFI::falseSym);
+                DISPATCH();
+            }
 
-                    ++m_ip;
-                    uint16_t id = readNumber();
+            TARGET(YIELD)
+            {
+                /*
+                    Argument: none
+                    Job: Suspend the coroutine being run, giving the value on top of the stack to the
+                            frame which resumed it. The coroutine gets back the value it is resumed with
+                */
+
+                yield(std::move(*pop()));
+                if constexpr (profile)
+                    syncProfiler();
+
+                // the coroutine was resumed by the caller of this run (call() or resolve())
+                if (!m_running)
+                    goto finished;
+                DISPATCH();
+            }
 
-                    if constexpr (debug)
-                        Ark::logger.info("BUILTIN ({0}) PP:{1}, IP:{2}"s, FFI::builtins[id].first, m_pp, m_ip);
+            TARGET(RESUME)
+            {
+                Value coroutine = std::move(*pop());
+                if (coroutine.valueType() != ValueType::Coroutine)
+                    throw Ark::TypeError("Argument of resume must be a Coroutine");
+
+                resume(std::move(coroutine), Value(FFI::nil));
+                if constexpr (profile)
+                    syncProfiler();
+                DISPATCH();
+            }
 
-                    push(FFI::builtins[id].second);
-                    break;
-                }
-                
-                case Instruction::MUT:
-                {
-                    /*
-                        Argument: symbol id (two bytes, big endian)
-                        Job: Take the value on top of the stack and create a variable in the current scope,
-                            named following the given symbol id (cf symbols table)
-                    */
+            TARGET(INCREMENT)
+            {
+                /*
+                    Arguments: symbol id, constant id (two bytes each, big endian, the second one being
+                                decoded to an extension word)
+                    Job: Add the constant to the variable named following the symbol id, in the nearest scope.
+                            Same as LOAD_SYMBOL, LOAD_CONST, ADD, STORE
+                */
 
-                    ++m_ip;
-                    uint16_t id = readNumber();
+                uint16_t id = arg;
+                uint16_t cst_id = FETCH_EXTENSION();
+                const Value& cst = m_state->m_constants[cst_id & ~ConstantFirst];
 
-                    if constexpr (debug)
-                        Ark::logger.info("MUT ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
+                if constexpr (debug)
+                    Ark::logger.info("INCREMENT ({0}, {1}) PP:{2}, IP:{3}"s, m_state->m_symbols[id], cst, m_pp, m_ip);
 
-                    registerVariable(id, *pop()).m_const = false;
-                    break;
-                }
-                
-                case Instruction::DEL:
-                {
-                    /*
-                        Argument: symbol id (two bytes, big endian)
-                        Job: Remove a variable/constant named following the given symbol id (cf symbols table)
-                    */
+                Value* var = findNearestVariable(id);
+                if (var == nullptr)
+                    throwVMError("couldn't find symbol to load: " + m_state->m_symbols[id]);
 
-                    ++m_ip;
-                    uint16_t id = readNumber();
+                m_last_sym_loaded = id;
+                increment(var, cst, id, /* add */ true, /* constant_first */ (cst_id & ConstantFirst) != 0);
+                DISPATCH();
+            }
 
-                    if constexpr (debug)
-                        Ark::logger.info("DEL ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
-                    
-                    Value* var = findNearestVariable(id);
-                    if (var != nullptr)
-                    {
-                        *var = FFI::undefined;
-                        break;
-                    }
+            TARGET(DECREMENT)
+            {
+                /*
+                    Arguments: symbol id, constant id (two bytes each, big endian, the second one being
+                                decoded to an extension word)
+                    Job: Subtract the constant from the variable named following the symbol id, in the nearest
+                            scope. Same as LOAD_SYMBOL, LOAD_CONST, SUB, STORE
+                */
 
-                    throwVMError("couldn't find symbol: " + m_state->m_symbols[id]);
-                    break;
-                }
-                
-                case Instruction::SAVE_ENV:
-                {
-                    /*
-                        Argument: none
-                        Job: Save the current environment, useful for quoted code
-                    */
-                    m_saved_scope = m_locals.back();
-                    break;
-                }
-                
-                case Instruction::GET_FIELD:
-                {
-                    /*
-                        Argument: symbol id (two bytes, big endian)
-                        Job: Used to read the field named following the given symbol id (cf symbols table) of a `Closure`
-                            stored in TS. Pop TS and push the value of field read on the stack
-                    */
+                uint16_t id = arg;
+                const Value& cst = m_state->m_constants[FETCH_EXTENSION()];
 
-                    ++m_ip;
-                    uint16_t id = readNumber();
+                if constexpr (debug)
+                    Ark::logger.info("DECREMENT ({0}, {1}) PP:{2}, IP:{3}"s, m_state->m_symbols[id], cst, m_pp, m_ip);
 
-                    if constexpr (debug)
-                        Ark::logger.info("GET_FIELD ({0}) PP:{1}, IP:{2}"s, m_state->m_symbols[id], m_pp, m_ip);
-                    
-                    Value* var = pop();
-                    if (var->valueType() != ValueType::Closure)
-                        throwVMError("variable `" + m_state->m_symbols[m_last_sym_loaded] + "' isn't a closure, can not get the field `" + m_state->m_symbols[id] + "' from it");
-                    
-                    const Value& field = (*var->closure_ref().scope())[id];
-                    if (field != FFI::undefined)
-                    {
-                        if constexpr (debug)
-                            Ark::logger.data("Pushing closure field:", field);
-                        
-                        // check for CALL instruction
-                        if (m_ip + 1 < m_state->m_pages[m_pp].size() && m_state->m_pages[m_pp][m_ip + 1] == Instruction::CALL)
-                        {
-                            m_locals.push_back(var->closure_ref().scope());
-                            m_frames.back().incScopeCountToDelete();
-                        }
-
-                        push(field);
-                        break;
-                    }
+                Value* var = findNearestVariable(id);
+                if (var == nullptr)
+                    throwVMError("couldn't find symbol to load: " + m_state->m_symbols[id]);
 
-                    throwVMError("couldn't find symbol in closure enviroment: " + m_state->m_symbols[id]);
-                    break;
-                }
-                
-                default:
-                    throwVMError("unknown instruction: " + Ark::Utils::toString(static_cast<std::size_t>(inst)));
-                    break;
-                }
-            else if (Instruction::FIRST_OPERATOR <= inst && inst <= Instruction::LAST_OPERATOR)
-                switch (inst)
-                {
-                    case Instruction::ADD:
-                    {
-                        Value *b = pop(), *a = pop();
-                        if (a->valueType() == ValueType::Number)
-                        {
-                            if (b->valueType() != ValueType::Number)
-                                throw Ark::TypeError("Arguments of + should have the same type");
-                            
-                            push(Value(a->number() + b->number()));
-                            break;
-                        }
-                        else if (a->valueType() == ValueType::String)
-                        {
-                            if (b->valueType() != ValueType::String)
-                                throw Ark::TypeError("Arguments of + should have the same type");
-                            
-                            push(Value(a->string() + b->string()));
-                            break;
-                        }
-                        throw Ark::TypeError("Arguments of + should be Numbers or Strings");
-                    }
+                m_last_sym_loaded = id;
+                increment(var, cst, id, /* add */ false, /* constant_first */ false);
+                DISPATCH();
+            }
 
-                    case Instruction::SUB:
-                    {
-                        Value *b = pop(), *a = pop();
-                        if (a->valueType() != ValueType::Number)
-                            throw Ark::TypeError("Arguments of - should be Numbers");
-                        if (b->valueType() != ValueType::Number)
-                            throw Ark::TypeError("Arguments of - should be Numbers");
-                        
-                        push(Value(a->number() - b->number()));
-                        break;
-                    }
+            TARGET(INCREMENT_LOCAL)
+            {
+                /*
+                    Arguments: slot of the variable in the current scope, constant id (two bytes each, big
+                                endian, the second one being decoded to an extension word)
+                    Job: Add the constant to a local variable. Same as LOAD_LOCAL, LOAD_CONST, ADD, STORE_LOCAL
+                */
 
-                    case Instruction::MUL:
-                    {
-                        Value *b = pop(), *a = pop();
-                        if (a->valueType() != ValueType::Number)
-                            throw Ark::TypeError("Arguments of * should be Numbers");
-                        if (b->valueType() != ValueType::Number)
-                            throw Ark::TypeError("Arguments of * should be Numbers");
-                        
-                        push(Value(a->number() * b->number()));
-                        break;
-                    }
+                Value& local = m_locals.back()->slot(arg);
+                uint16_t id = m_locals.back()->idOf(arg);
+                uint16_t cst_id = FETCH_EXTENSION();
+                const Value& cst = m_state->m_constants[cst_id & ~ConstantFirst];
 
-                    case Instruction::DIV:
-                    {
-                        Value *b = pop(), *a = pop();
-                        if (a->valueType() != ValueType::Number)
-                            throw Ark::TypeError("Arguments of / should be Numbers");
-                        if (b->valueType() != ValueType::Number)
-                            throw Ark::TypeError("Arguments of / should be Numbers");
-                        
-                        auto d = b->number();
-                        if (d == 0)
-                            throw Ark::ZeroDivisionError();
-                        
-                        push(Value(a->number() / d));
-                        break;
-                    }
+                if constexpr (debug)
+                    Ark::logger.info("INCREMENT_LOCAL ({0}, {1}) PP:{2}, IP:{3}"s, m_state->m_symbols[id], cst, m_pp, m_ip);
 
-                    case Instruction::GT:
-                    {
-                        Value *b = pop(), *a = pop();
-                        push((!(*a == *b) && !(*a < *b)) ? FFI::trueSym : FFI::falseSym);
-                        break;
-                    }
-                    
-                    case Instruction::LT:
-                    {
-                        Value *b = pop(), *a = pop();
-                        push((*a < *b) ? FFI::trueSym : FFI::falseSym);
-                        break;
-                    }
+                Value* var = (local != FFI::undefined) ? &local : findNearestVariable(id);
+                if (var == nullptr)
+                    throwVMError("couldn't find symbol to load: " + m_state->m_symbols[id]);
 
-                    case Instruction::LE:
-                    {
-                        Value *b = pop(), *a = pop();
-                        push(((*a < *b) || (*a == *b)) ? FFI::trueSym : FFI::falseSym);
-                        break;
-                    }
+                m_last_sym_loaded = id;
+                increment(var, cst, id, /* add */ true, /* constant_first */ (cst_id & ConstantFirst) != 0);
+                DISPATCH();
+            }
 
-                    case Instruction::GE:
-                    {
-                        Value *b = pop(), *a = pop();
-                        push(!(*a < *b) ? FFI::trueSym : FFI::falseSym);
-                        break;
-                    }
+            TARGET(DECREMENT_LOCAL)
+            {
+                /*
+                    Arguments: slot of the variable in the current scope, constant id (two bytes each, big
+                                endian, the second one being decoded to an extension word)
+                    Job: Subtract the constant from a local variable. Same as LOAD_LOCAL, LOAD_CONST, SUB, STORE_LOCAL
+                */
 
-                    case Instruction::NEQ:
-                    {
-                        Value *b = pop(), *a = pop();
-                        push((*a != *b) ? FFI::trueSym : FFI::falseSym);
-                        break;
-                    }
+                Value& local = m_locals.back()->slot(arg);
+                uint16_t id = m_locals.back()->idOf(arg);
+                const Value& cst = m_state->m_constants[FETCH_EXTENSION()];
 
-                    case Instruction::EQ:
-                    {
-                        Value *b = pop(), *a = pop();
-                        push((*a == *b) ? FFI::trueSym : FFI::falseSym);
-                        break;
-                    }
+                if constexpr (debug)
+                    Ark::logger.info("DECREMENT_LOCAL ({0}, {1}) PP:{2}, IP:{3}"s, m_state->m_symbols[id], cst, m_pp, m_ip);
 
-                    case Instruction::LEN:
-                    {
-                        Value *a = pop();
-                        if (a->valueType() == ValueType::List)
-                        {
-                            push(Value(static_cast<int>(a->const_list().size())));
-                            break;
-                        }
-                        if (a->valueType() == ValueType::String)
-                        {
-                            push(Value(static_cast<int>(a->string().size())));
-                            break;
-                        }
-
-                        throw Ark::TypeError("Argument of len must be a list or a String");
-                    }
+                Value* var = (local != FFI::undefined) ? &local : findNearestVariable(id);
+                if (var == nullptr)
+                    throwVMError("couldn't find symbol to load: " + m_state->m_symbols[id]);
 
-                    case Instruction::EMPTY:
-                    {
-                        Value* a = pop();
-                        if (a->valueType() == ValueType::List)
-                            push((a->const_list().size() == 0) ? FFI::trueSym : FFI::falseSym);
-                        else if (a->valueType() == ValueType::String)
-                            push((a->string().size() == 0) ? FFI::trueSym : FFI::falseSym);
-                        else
-                            throw Ark::TypeError("Argument of empty? must be a list or a String");
-                        
-                        break;
-                    }
+                m_last_sym_loaded = id;
+                increment(var, cst, id, /* add */ false, /* constant_first */ false);
+                DISPATCH();
+            }
 
-                    case Instruction::FIRSTOF:
-                    {
-                        Value a = *pop();
-                        if (a.valueType() == ValueType::List)
-                            push(a.const_list().size() > 0 ? (a.const_list())[0] : FFI::nil);
-                        else if (a.valueType() == ValueType::String)
-                            push(a.string().size() > 0 ? Value(std::string(1, (a.string())[0])) : FFI::nil);
-                        else
-                            throw Ark::TypeError("Argument of firstOf must be a list");
-
-                        break;
-                    }
+            TARGET(ADD_CONST)
+            {
+                /*
+                    Argument: constant id (two bytes, big endian)
+                    Job: Add the constant to the value on top of the stack. Same as LOAD_CONST, ADD
+                */
+
+                Value& a = m_stack[m_sp - 1];
+                const Value& cst = m_state->m_constants[arg];
+                if (a.valueType() == ValueType::Number && cst.valueType() == ValueType::Number)
+                {
+                    a = addNumbers(a, cst);
+                    DISPATCH();
+                }
 
-                    case Instruction::TAILOF:
-                    {
-                        Value* a = pop();
-                        if (a->valueType() == ValueType::List)
-                        {
-                            if (a->const_list().size() < 2)
-                            {
-                                push(FFI::nil);
-                                break;
-                            }
-                            
-                            a->list().erase(a->const_list().begin());
-                            push(*a);
-                        }
-                        else if (a->valueType() == ValueType::String)
-                        {
-                            if (a->string().size() < 2)
-                            {
-                                push(FFI::nil);
-                                break;
-                            }
-
-                            a->string_ref().erase(a->string().begin());
-                            push(*a);
-                        }
-                        else
-                            throw Ark::TypeError("Argument of tailOf must be a list or a String");
-                        
-                        break;
-                    }
+                // strings and type errors are handled by ADD
+                push(cst);
+                inst = Instruction::ADD;
+                DISPATCH_GOTO();
+            }
 
-                    case Instruction::HEADOF:
-                    {
-                        Value* a = pop();
-                        if (a->valueType() == ValueType::List)
-                        {
-                            if (a->const_list().size() < 2)
-                            {
-                                push(FFI::nil);
-                                break;
-                            }
-                            
-                            a->list().pop_back();
-                            push(*a);
-                        }
-                        else if (a->valueType() == ValueType::String)
-                        {
-                            if (a->string().size() < 2)
-                            {
-                                push(FFI::nil);
-                                break;
-                            }
-                            
-                            a->string_ref().pop_back();
-                            push(*a);
-                        }
-                        else
-                            throw Ark::TypeError("Argument of headOf must be a list or a String");
-                        
-                        break;
-                    }
+            TARGET(SUB_CONST)
+            {
+                /*
+                    Argument: constant id (two bytes, big endian)
+                    Job: Subtract the constant from the value on top of the stack. Same as LOAD_CONST, SUB
+                */
+
+                Value& a = m_stack[m_sp - 1];
+                const Value& cst = m_state->m_constants[arg];
+                if (a.valueType() == ValueType::Number && cst.valueType() == ValueType::Number)
+                {
+                    a = subNumbers(a, cst);
+                    DISPATCH();
+                }
 
-                    case Instruction::ISNIL:
-                    {
-                        push((*pop() == FFI::nil) ? FFI::trueSym : FFI::falseSym);
-                        break;
-                    }
+                // type errors are handled by SUB
+                push(cst);
+                inst = Instruction::SUB;
+                DISPATCH_GOTO();
+            }
 
-                    case Instruction::ASSERT:
-                    {
-                        Value *b = pop(), *a = pop();
-                        if (*a == FFI::falseSym)
-                        {
-                            if (b->valueType() != ValueType::String)
-                                throw Ark::TypeError("Second argument of assert must be a String");
-
-                            throw Ark::AssertionFailed(b->string());
-                        }
-                        break;
-                    }
+            /*
+                Argument: absolute address to jump to (two bytes, big endian, decoded to an instruction index)
+                Job: Compare the two values on top of the stack and remove them, then jump to the provided
+                        address if the comparison is false. Same as the comparison operator followed
+                        by POP_JUMP_IF_FALSE
+            */
 
-                    case Instruction::TO_NUM:
-                    {
-                        Value* a = pop();
-                        if (a->valueType() != ValueType::String)
-                            throw Ark::TypeError("Argument of toNumber must be a String");
-                        
-                        if (Utils::isDouble(a->string()))
-                            push(Value(std::stod(a->string().c_str())));
-                        else
-                            push(FFI::nil);
-                        break;
-                    }
+            TARGET(GT_JUMP_IF_FALSE)
+            {
+                Value *b = pop(), *a = pop();
+                bool numbers = a->valueType() == ValueType::Number && b->valueType() == ValueType::Number;
+                if (*a == *b || (numbers ? lessNumbers(*a, *b) : *a < *b))
+                    m_ip = arg;
+                DISPATCH();
+            }
 
-                    case Instruction::TO_STR:
-                    {
-                        std::stringstream ss;
-                        ss << (*pop());
-                        push(Value(ss.str()));
-                        break;
-                    }
+            TARGET(LT_JUMP_IF_FALSE)
+            {
+                Value *b = pop(), *a = pop();
+                bool numbers = a->valueType() == ValueType::Number && b->valueType() == ValueType::Number;
+                if (!(numbers ? lessNumbers(*a, *b) : *a < *b))
+                    m_ip = arg;
+                DISPATCH();
+            }
 
-                    case Instruction::AT:
-                    {
-                        Value *b = pop(), a = *pop();
-                        if (b->valueType() != ValueType::Number)
-                            throw Ark::TypeError("Argument 2 of @ should be a Number");
-
-                        if (a.valueType() == ValueType::List)
-                            push(a.list()[static_cast<long>(b->number())]);
-                        else if (a.valueType() == ValueType::String)
-                            push(Value(std::string(1, a.string()[static_cast<long>(b->number())])));
-                        else
-                            throw Ark::TypeError("Argument 1 of @ should be a List or a String");
-                        break;
-                    }
+            TARGET(LE_JUMP_IF_FALSE)
+            {
+                Value *b = pop(), *a = pop();
+                bool numbers = a->valueType() == ValueType::Number && b->valueType() == ValueType::Number;
+                if (!((numbers ? lessNumbers(*a, *b) : *a < *b) || *a == *b))
+                    m_ip = arg;
+                DISPATCH();
+            }
 
-                    case Instruction::AND_:
-                    {
-                        Value *a = pop(), *b = pop();
-                        push((*a == FFI::trueSym && *b == FFI::trueSym) ? FFI::trueSym : FFI::falseSym);
-                        break;
-                    }
+            TARGET(GE_JUMP_IF_FALSE)
+            {
+                Value *b = pop(), *a = pop();
+                bool numbers = a->valueType() == ValueType::Number && b->valueType() == ValueType::Number;
+                if (numbers ? lessNumbers(*a, *b) : *a < *b)
+                    m_ip = arg;
+                DISPATCH();
+            }
 
-                    case Instruction::OR_:
-                    {
-                        Value *a = pop(), *b = pop();
-                        push((*b == FFI::trueSym || *a == FFI::trueSym) ? FFI::trueSym : FFI::falseSym);
-                        break;
-                    }
+            TARGET(NEQ_JUMP_IF_FALSE)
+            {
+                Value *b = pop(), *a = pop();
+                if (*a == *b)
+                    m_ip = arg;
+                DISPATCH();
+            }
 
-                    case Instruction::MOD:
-                    {
-                        Value *b = pop(), *a = pop();
-                        if (a->valueType() != ValueType::Number)
-                            throw Ark::TypeError("Arguments of mod should be Numbers");
-                        if (b->valueType() != ValueType::Number)
-                            throw Ark::TypeError("Arguments of mod should be Numbers");
-                        
-                        push(Value(std::fmod(a->number(), b->number())));
-                        break;
-                    }
+            TARGET(EQ_JUMP_IF_FALSE)
+            {
+                Value *b = pop(), *a = pop();
+                if (*a != *b)
+                    m_ip = arg;
+                DISPATCH();
+            }
 
-                    case Instruction::TYPE:
-                    {
-                        Value *a = pop();
-                        if (a->valueType() != ValueType::NFT)
-                            push(types_to_str[static_cast<unsigned>(a->valueType())]);
-                        else if (a->nft() == NFT::True || a->nft() == NFT::False)
-                            push(types_to_str[8]);
-                        else if (a->nft() == NFT::Nil)
-                            push(types_to_str[7]);
-                        else
-                            push(types_to_str[9]);
-                        break;
-                    }
+            TARGET(CALL_BUILTIN)
+            {
+                /*
+                    Arguments: id of builtin, number of arguments (two bytes each, big endian, the second
+                                one being decoded to an extension word)
+                    Job: Call the builtin with the given number of arguments taken from the stack, without
+                            pushing it first. Same as BUILTIN, CALL
+                */
 
-                    case Instruction::HASFIELD:
-                    {
-                        Value *field = pop(), *closure = pop();
-                        if (closure->valueType() != ValueType::Closure)
-                            throw Ark::TypeError("Argument no 1 of hasField should be a Closure");
-                        if (field->valueType() != ValueType::String)
-                            throw Ark::TypeError("Argument no 2 of hasField should be a String");
-                        
-                        auto it = std::find(m_state->m_symbols.begin(), m_state->m_symbols.end(), field->string());
-                        if (it == m_state->m_symbols.end())
-                        {
-                            push(FFI::falseSym);
-                            break;
-                        }
-                        uint16_t id = static_cast<uint16_t>(std::distance(m_state->m_symbols.begin(), it));
-                        
-                        if ((*closure->closure_ref().scope_ref())[id] != FFI::undefined)
-                            push(FFI::trueSym);
-                        else
-                            push(FFI::falseSym);
-                        
-                        break;
-                    }
+                uint16_t argc = FETCH_EXTENSION();
+                const Value& builtin = FFI::builtins[arg].second;
 
-                    case Instruction::NOT:
-                    {
-                        bool a = !(*pop());
-                        if (a)
-                            push(FFI::trueSym);
-                        else
-                            push(FFI::falseSym);
-                        break;
-                    }
+                if constexpr (debug)
+                    Ark::logger.info("CALL_BUILTIN ({0}, {1}) PP:{2}, IP:{3}"s, FFI::builtins[arg].first, argc, m_pp, m_ip);
+
+                if (builtin.valueType() == ValueType::CProc && builtin.proc().native != nullptr)
+                    callNative(builtin.proc().native, argc);
+                else
+                {
+                    // not a function, let CALL report it
+                    push(builtin);
+                    call(argc);
                 }
-            else
+                DISPATCH();
+            }
+
+#if ARK_USE_COMPUTED_GOTO
+        unknown_instruction:
+#else
+            default:
+#endif
                 throwVMError("unknown instruction: " + Ark::Utils::toString(static_cast<std::size_t>(inst)));
-            
-            // move forward
-            ++m_ip;
         }
+    } catch (const Ark::ExecutionCancelled&) {
+        m_until_frame_count = old_until_frame_count;
+        m_running = old_running;
+        if constexpr (profile)
+            stopProfiler(untilFrameCount);
+        execution_context = old_context;
+        abortCoroutines(untilFrameCount);
+
+        // a nested run stops the one which called it
+        if (untilFrameCount != 0)
+            throw;
+        m_interrupts.fetch_and(~InterruptCancel, std::memory_order_relaxed);
+        return Cancelled;
     } catch (const std::exception& e) {
+        m_until_frame_count = old_until_frame_count;
+        m_running = old_running;
+        if constexpr (profile)
+            stopProfiler(untilFrameCount);
+        execution_context = old_context;
+        abortCoroutines(untilFrameCount);
+
+        // source location of an instruction, if the bytecode has the debug information
+        auto location = [this](std::size_t page, std::size_t ip) -> std::string {
+            if (auto loc = m_state->sourceLocation(static_cast<PageAddr_t>(page), ip))
+                return " (" + loc->file + ":" + Ark::Utils::toString(loc->line) + ":" + Ark::Utils::toString(loc->col) + ")";
+            return "";
+        };
+        std::size_t ip = m_ip != 0 ? m_ip - 1 : 0, pp = m_pp;
+
         std::cerr << "\n" << termcolor::red << e.what() << "\n";
-        std::cerr << termcolor::reset << "At IP: " << (m_ip != -1 ? m_ip : 0) << ", PP: " << m_pp << "\n";
+        std::cerr << termcolor::reset << "At IP: " << ip << ", PP: " << pp << location(pp, ip) << "\n";
 
         if (m_frames.size() > 1)
         {
@@ -862,11 +1881,22 @@ int VM_t<debug>::safeRun(std::size_t untilFrameCount)
                     uint16_t id = findNearestVariableIdWithValue(
                         Value(static_cast<PageAddr_t>(it->currentPageAddr()))
                     );
-                    
-                    std::cerr << "In function `" << termcolor::green << m_state->m_symbols[id] << termcolor::reset << "'\n";
+                    std::string name = (id < m_state->m_symbols.size()) ? m_state->m_symbols[id] :
+                        m_state->pageName(static_cast<PageAddr_t>(it->currentPageAddr()));
+
+                    // functions called through a value (eg by a worker) may not have a name
+                    if (!name.empty())
+                        std::cerr << "In function `" << termcolor::green << name << termcolor::reset << "'";
+                    else
+                        std::cerr << "In an anonymous function";
                 }
                 else
-                    std::cerr << "In global scope\n";
+                    std::cerr << "In global scope";
+                std::cerr << location(pp, ip) << "\n";
+
+                // the caller is at the call instruction, the frame kept the address following it
+                ip = it->callerAddr() != 0 ? it->callerAddr() - 1 : 0;
+                pp = it->callerPageAddr();
 
                 if (std::distance(m_frames.rbegin(), it) > 7)
                 {
@@ -877,39 +1907,219 @@ int VM_t<debug>::safeRun(std::size_t untilFrameCount)
 
             // if persistance is on, clear frames to keep only the global one
             if (m_state->m_options & FeaturePersist)
+            {
+                m_sp = m_frames[1].stackBase();
                 m_frames.erase(m_frames.begin() + 1, m_frames.end());
+            }
         }
 
         return 1;
     } catch (...) {
+        m_until_frame_count = old_until_frame_count;
+        m_running = old_running;
+        if constexpr (profile)
+            stopProfiler(untilFrameCount);
+        execution_context = old_context;
+        abortCoroutines(untilFrameCount);
+
         std::cerr << "Unknown error" << std::endl;
         return 1;
     }
+
+yielded:
+    m_until_frame_count = old_until_frame_count;
+    m_running = old_running;
+    if constexpr (profile)
+        stopProfiler(untilFrameCount);
+    execution_context = old_context;
+    m_suspended = true;
+    return Yielded;
+
+finished:
+    m_until_frame_count = old_until_frame_count;
+    m_running = old_running;
+    if constexpr (profile)
+        stopProfiler(untilFrameCount);
+    execution_context = old_context;
     return 0;
+
+    #undef TICK
+    #undef TARGET
+    #undef DISPATCH_GOTO
+    #undef FETCH_INSTRUCTION
+    #undef DISPATCH
+    #undef FETCH_EXTENSION
+}
+
+// ------------------------------------------
+//                coroutines
+// ------------------------------------------
+
+template<bool debug>
+void VM_t<debug>::resume(internal::Value&& coroutine, internal::Value&& sent)
+{
+    using namespace Ark::internal;
+
+    Coroutine& co = coroutine.coroutine_ref();
+    // coroutines aren't copied, the other threads could be resuming it too
+    if (m_worker_run != 0 && co.m_owner != this)
+        throwVMError("can not resume in a function called in parallel a coroutine created outside of it");
+    if (co.m_status == Coroutine::Status::Done)
+    {
+        // nothing left to give
+        push(FFI::nil);
+        return;
+    }
+    if (co.m_status == Coroutine::Status::Running)
+        throwVMError("can not resume a coroutine which is already running");
+
+    co.m_frames_base = m_frames.size();
+    co.m_locals_base = m_locals.size();
+    co.m_caller_scope_count = m_frames.back().scopeCountToDelete();
+
+    bool first_run = co.m_status == Coroutine::Status::Created;
+    co.m_status = Coroutine::Status::Running;
+    m_coroutines.push_back(std::move(coroutine));
+
+    if (first_run)
+    {
+        // called like CALL would, returning to the instruction following the resume
+        uint16_t argc = static_cast<uint16_t>(co.m_args.size());
+        for (Value& arg : co.m_args)
+            push(std::move(arg));
+        push(std::move(co.m_function));
+        co.m_args.clear();
+        co.m_function = FFI::nil;
+
+        // the function isn't called through its symbol
+        m_last_sym_loaded = static_cast<uint16_t>(m_state->m_symbols.size());
+        call(argc);
+
+        // builtins return at once
+        if (m_frames.size() == co.m_frames_base)
+            finishCoroutine();
+        return;
+    }
+
+    // put back the frames, values and scopes of the coroutine on top of the current ones
+    std::size_t base = m_sp;
+    for (Frame& frame : co.m_frames)
+    {
+        frame.setStackBase(base + frame.stackBase());
+        m_frames.push_back(frame);
+    }
+    m_frames[co.m_frames_base].setCaller(m_ip, m_pp);
+    for (Value& value : co.m_stack)
+        push(std::move(value));
+    for (Scope_t& scope : co.m_scopes)
+        m_locals.push_back(std::move(scope));
+    m_frames[co.m_frames_base - 1].setScopeCountToDelete(co.m_caller_scope_count + co.m_caller_scopes);
+
+    co.m_frames.clear();
+    co.m_stack.clear();
+    co.m_scopes.clear();
+
+    m_ip = co.m_ip;
+    m_pp = co.m_pp;
+    reserveStack();
+    push(std::move(sent));
+}
+
+template<bool debug>
+void VM_t<debug>::yield(internal::Value&& value)
+{
+    using namespace Ark::internal;
+
+    if (m_coroutines.empty())
+        throwVMError("yield can only be used in a coroutine");
+
+    Coroutine& co = m_coroutines.back().coroutine_ref();
+    // the frames between the coroutine and us belong to a builtin or a plugin, waiting for a result
+    if (co.m_frames_base < m_until_frame_count)
+        throwVMError("can not yield from a function called by a builtin or a plugin");
+
+    // take the frames, values and scopes of the coroutine
+    std::size_t base = m_frames[co.m_frames_base].stackBase();
+    std::size_t caller_ip = m_frames[co.m_frames_base].callerAddr();
+    std::size_t caller_pp = m_frames[co.m_frames_base].callerPageAddr();
+
+    co.m_frames.assign(m_frames.begin() + co.m_frames_base, m_frames.end());
+    for (Frame& frame : co.m_frames)
+        frame.setStackBase(frame.stackBase() - base);
+    m_frames.erase(m_frames.begin() + co.m_frames_base, m_frames.end());
+
+    co.m_stack.assign(
+        std::make_move_iterator(m_stack.begin() + base),
+        std::make_move_iterator(m_stack.begin() + m_sp)
+    );
+    m_sp = base;
+
+    co.m_scopes.assign(
+        std::make_move_iterator(m_locals.begin() + co.m_locals_base),
+        std::make_move_iterator(m_locals.end())
+    );
+    m_locals.erase(m_locals.begin() + co.m_locals_base, m_locals.end());
+
+    // the environment of a closure is deleted by the frame which called it
+    co.m_caller_scopes = m_frames.back().scopeCountToDelete() - co.m_caller_scope_count;
+    m_frames.back().setScopeCountToDelete(co.m_caller_scope_count);
+
+    co.m_ip = m_ip;
+    co.m_pp = m_pp;
+    co.m_status = Coroutine::Status::Suspended;
+    m_coroutines.pop_back();
+
+    m_ip = caller_ip;
+    m_pp = caller_pp;
+    push(std::move(value));
+
+    if (m_frames.size() == m_until_frame_count)
+        m_running = false;
 }
 
 // ------------------------------------------
 //            stack management
 // ------------------------------------------
 
+// a popped value stays valid until something else is pushed in its slot
+
 template<bool debug>
-inline internal::Value* VM_t<debug>::pop(int page)
+inline internal::Value* VM_t<debug>::pop()
 {
-    if (page == -1)
-        return m_frames.back().pop();
-    return m_frames[static_cast<std::size_t>(page)].pop();
+    return &m_stack[--m_sp];
 }
 
 template<bool debug>
-void VM_t<debug>::push(const internal::Value& value)
+inline void VM_t<debug>::push(const internal::Value& value)
 {
-    m_frames.back().push(value);
+    if (m_sp == m_stack.size())
+    {
+        // the value could come from the stack itself
+        internal::Value copy = value;
+        growStack();
+        m_stack[m_sp++] = std::move(copy);
+    }
+    else
+        m_stack[m_sp++] = value;
 }
 
 template<bool debug>
 inline void VM_t<debug>::push(internal::Value&& value)
 {
-    m_frames.back().push(std::move(value));
+    if (m_sp == m_stack.size())
+    {
+        internal::Value copy = std::move(value);
+        growStack();
+        m_stack[m_sp++] = std::move(copy);
+    }
+    else
+        m_stack[m_sp++] = std::move(value);
+}
+
+template<bool debug>
+void VM_t<debug>::growStack()
+{
+    m_stack.resize(m_stack.size() * 2);
 }
 
 // ------------------------------------------
@@ -917,32 +2127,21 @@ inline void VM_t<debug>::push(internal::Value&& value)
 // ------------------------------------------
 
 template<bool debug>
-inline void VM_t<debug>::call(int16_t argc_)
+inline void VM_t<debug>::call(uint16_t argc, internal::Scope_t* scope)
 {
     /*
         Argument: number of arguments when calling the function
         Job: Call function from its symbol id located on top of the stack. Take the given number of
-                arguments from the top of stack and give them  to the function (the first argument taken
-                from the stack will be the last one of the function). The stack of the function is now composed
-                of its arguments, from the first to the last one
+                arguments from the top of stack and give them to the function (the first argument taken
+                from the stack will be the last one of the function). The arguments aren't moved: the stack
+                of the function starts at its first argument
     */
     using namespace Ark::internal;
 
-    uint16_t argc = 0;
-
-    // handling calls from C++ code
-    if (argc_ <= -1)
-    {
-        ++m_ip;
-        argc = readNumber();
-    }
-    else
-        argc = argc_;
-
     if constexpr (debug)
         Ark::logger.info("CALL ({0}) PP:{1}, IP:{2}"s, argc, m_pp, m_ip);
 
-    Value function = *pop();
+    Value function = std::move(*pop());
     if constexpr (debug)
         Ark::logger.data("function object:", function);
 
@@ -951,79 +2150,191 @@ inline void VM_t<debug>::call(int16_t argc_)
         // is it a builtin function name?
         case ValueType::CProc:
         {
-            // drop arguments from the stack
-            std::vector<Value> args(argc);
-            for (uint16_t j=0; j < argc; ++j)
-            {
-                args[argc - 1 - j] = *pop();
-                args[j].registerVM(this);  // so that plugin can call .resolve(...) on functions they were sent
-            }
-            
+            const Value::Procedure& proc = function.proc();
+
+            if (proc.native != nullptr)
+                return callNative(proc.native, argc);
+
+            // move arguments out of the stack, they are already in the right order
+            m_sp -= argc;
+            std::vector<Value> args(
+                std::make_move_iterator(m_stack.begin() + m_sp),
+                std::make_move_iterator(m_stack.begin() + m_sp + argc)
+            );
+
             // call proc
-            push(function.proc()(args));
+            push(proc.function(args));
             return;
         }
 
         // is it a user defined function?
         case ValueType::PageAddr:
         {
-            int old_frame = m_frames.size() - 1;
             PageAddr_t new_page_pointer = function.pageAddr();
 
-            // create dedicated frame
-            createNewScope();
-            m_frames.emplace_back(m_ip, m_pp, new_page_pointer);
+            // create dedicated frame, starting at the arguments which are left in place
+            createNewScope(new_page_pointer, scope);
+            m_frames.emplace_back(m_ip, m_pp, new_page_pointer, m_sp - argc);
             // store "reference" to the function to speed the recursive functions
             if (m_last_sym_loaded < m_state->m_symbols.size())
                 registerVariable(m_last_sym_loaded, function);
 
             m_pp = new_page_pointer;
-            m_ip = -1;  // because we are doing a m_ip++ right after that
-            for (std::size_t j=0; j < argc; ++j)
-                push(*pop(old_frame));
+            m_ip = 0;
             break;
         }
 
         // is it a user defined closure?
         case ValueType::Closure:
         {
-            int old_frame = m_frames.size() - 1;
             Closure& c = function.closure_ref();
             PageAddr_t new_page_pointer = c.pageAddr();
 
             // load saved scope
-            m_locals.push_back(c.scope());
+            m_locals.push_back(closureScope(c));
             // create dedicated frame
-            createNewScope();
+            createNewScope(new_page_pointer, scope);
             m_frames.back().incScopeCountToDelete();
-            m_frames.emplace_back(m_ip, m_pp, new_page_pointer);
+            m_frames.emplace_back(m_ip, m_pp, new_page_pointer, m_sp - argc);
 
             m_pp = new_page_pointer;
-            m_ip = -1;  // because we are doing a m_ip++ right after that
-            for (std::size_t j=0; j < argc; ++j)
-                push(*pop(old_frame));
+            m_ip = 0;
             break;
         }
 
+        // calling a coroutine resumes it, its argument being the value of the yield it stopped at
+        case ValueType::Coroutine:
+        {
+            if (argc > 1)
+                throwVMError("a coroutine can be resumed with 0 or 1 argument, received " + Ark::Utils::toString(argc));
+
+            Value sent = (argc == 1) ? std::move(*pop()) : FFI::nil;
+            return resume(std::move(function), std::move(sent));
+        }
+
         default:
             throwVMError("couldn't identify function object: type index " + Ark::Utils::toString(static_cast<int>(function.valueType())));
     }
 
+    reserveStack();
+    checkArity(argc);
+}
+
+template<bool debug>
+inline void VM_t<debug>::callNative(internal::Value::NativeProcType proc, uint16_t argc)
+{
+    using namespace Ark::internal;
+
+    // builtins work directly on the arguments, left on the stack until they return
+    Value result = proc(ArgsView(m_stack, m_sp - argc, argc), execution_context);
+    m_sp -= argc;
+    push(std::move(result));
+}
+
+template<bool debug>
+inline void VM_t<debug>::tailCall(uint16_t argc)
+{
+    /*
+        Argument: number of arguments when calling the function
+        Job: Same as CALL, for a call in tail position: the current function is done, the called one
+                takes its frame and scope, and will return directly to the caller of the current function
+    */
+    using namespace Ark::internal;
+
+    // only plain functions can take the frame: closures need their environment to stay until they
+    // return, and builtins don't have a frame
+    const Value& top = m_stack[m_sp - 1];
+    if (m_pp == 0 || top.valueType() != ValueType::PageAddr)
+        return call(argc);
+
+    if constexpr (debug)
+        Ark::logger.info("TAIL_CALL ({0}) PP:{1}, IP:{2}"s, argc, m_pp, m_ip);
+
+    Value function = std::move(*pop());
+    PageAddr_t new_page_pointer = function.pageAddr();
+
+    // the variables of the current function must stay visible to the called one (dynamic scope),
+    // thus they are given to its scope instead of keeping the current one
+    const std::vector<uint16_t>& locals = m_state->m_page_locals[new_page_pointer];
+
+    // the ones with the same name as a local of the called function are still visible to it until it
+    // defines its own, as they would be after a CALL: they are kept in a scope under its one, shared
+    // by the next tail calls of the frame, the nearest value of a variable being the only visible one
+    Frame& frame = m_frames.back();
+    if (!frame.hasHiddenScope() && m_locals.back()->defines(locals))
+    {
+        Scope_t hidden = std::make_shared<Scope>();
+        trackScope(hidden);
+        m_locals.insert(m_locals.end() - 1, std::move(hidden));
+        m_frames[m_frames.size() - 2].incScopeCountToDelete();
+        frame.setHiddenScope(true);
+    }
+    Scope* hidden = frame.hasHiddenScope() ? m_locals[m_locals.size() - 2].get() : nullptr;
+
+    // the scope is reused in place, unless a closure captured it
+    if (m_locals.back().use_count() == 1)
+        m_locals.back()->reuse(locals, hidden);
+    else
+    {
+        Scope_t old_scope = std::move(m_locals.back());
+        m_locals.back() = std::make_shared<Scope>(locals);
+        trackScope(m_locals.back());
+        m_locals.back()->inherit(*old_scope, hidden);
+    }
+    // store "reference" to the function to speed the recursive functions
+    if (m_last_sym_loaded < m_state->m_symbols.size())
+        registerVariable(m_last_sym_loaded, function);
+
+    // replace the values of the current frame by the arguments
+    std::size_t base = m_frames.back().stackBase();
+    for (std::size_t j=0; j < argc; ++j)
+        m_stack[base + j] = std::move(m_stack[m_sp - argc + j]);
+    m_sp = base + argc;
+
+    m_frames.back().setCurrentPageAddr(new_page_pointer);
+    m_pp = new_page_pointer;
+    m_ip = 0;
+
+    reserveStack();
+    checkArity(argc);
+}
+
+template<bool debug>
+inline void VM_t<debug>::increment(internal::Value* var, const internal::Value& cst, uint16_t id, bool add, bool constant_first)
+{
+    using namespace Ark::internal;
+
+    // same errors as the instructions replaced by INCREMENT and DECREMENT: ADD and SUB check their
+    // first operand, then the second one
+    if (var->valueType() != ValueType::Number || cst.valueType() != ValueType::Number)
+    {
+        if (!add)
+            throw Ark::TypeError("Arguments of - should be Numbers");
+
+        const Value& first = constant_first ? cst : *var;
+        if (first.valueType() == ValueType::String || first.valueType() == ValueType::Number)
+            throw Ark::TypeError("Arguments of + should have the same type");
+        throw Ark::TypeError("Arguments of + should be Numbers or Strings");
+    }
+    if (var->m_const)
+        throwVMError("can not modify a constant: " + m_state->m_symbols[id]);
+
+    *var = add ? addNumbers(*var, cst) : subNumbers(*var, cst);
+}
+
+template<bool debug>
+inline void VM_t<debug>::checkArity(std::size_t argc)
+{
+    using namespace Ark::internal;
+
     // checking function arity
-    std::size_t received_argc = m_frames.back().stackSize();
-    std::size_t needed_argc = 0;
     if (m_state->m_options & FeatureFunctionArityCheck)
     {
-        std::size_t index = 0;
-        while (m_state->m_pages[m_pp][index] == Instruction::MUT)
-        {
-            needed_argc += 1;
-            index += 3;  // jump the argument of MUT (integer on 2 bits, big endian)
-        }
+        std::size_t needed_argc = m_state->m_functions[m_pp].arity;
 
         if constexpr (debug)
-            Ark::logger.info("Function needs {0} arguments, and received {1}"s, needed_argc, received_argc);
-        if (needed_argc != received_argc)
-            throwVMError("Function needs " + Ark::Utils::toString(needed_argc) + " arguments, and received " + Ark::Utils::toString(received_argc));
+            Ark::logger.info("Function needs {0} arguments, and received {1}"s, needed_argc, argc);
+        if (needed_argc != argc)
+            throwVMError("Function needs " + Ark::Utils::toString(needed_argc) + " arguments, and received " + Ark::Utils::toString(argc));
     }
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#ifndef ark_vm_vmpool
+#define ark_vm_vmpool
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include <Ark/VM/VM.hpp>
+#include <Ark/VM/State.hpp>
+
+namespace Ark
+{
+    /*
+        VMs created once and bound to a single State, shared by the threads running its program.
+        The pool freezes the state, and each VM is used by one thread at a time, from acquire()
+        until its handle is destroyed
+    */
+    class VMPool
+    {
+    public:
+        // a VM borrowed from the pool, reset and given back when the handle is destroyed
+        class Handle
+        {
+        public:
+            Handle(VMPool* pool, VM* vm);
+            Handle(Handle&& other) noexcept;
+            Handle(const Handle&) = delete;
+            Handle& operator=(const Handle&) = delete;
+            ~Handle();
+
+            inline VM& operator*() const
+            {
+                return *m_vm;
+            }
+
+            inline VM* operator->() const
+            {
+                return m_vm;
+            }
+
+        private:
+            VMPool* m_pool;
+            VM* m_vm;
+        };
+
+        VMPool(State* state, std::size_t size=std::thread::hardware_concurrency());
+
+        // wait until a VM is available
+        Handle acquire();
+
+        std::size_t size() const;
+
+    private:
+        State* m_state;
+        std::vector<std::unique_ptr<VM>> m_vms;
+        std::vector<VM*> m_available;
+        std::mutex m_mutex;
+        std::condition_variable m_released;
+
+        void release(VM* vm);
+    };
+}
+
+#endif
@@ -2,13 +2,16 @@
 #define ark_vm_value
 
 #include <vector>
-#include <variant>
 #include <string>
 #include <cinttypes>
 #include <iostream>
 #include <memory>
 #include <functional>
 #include <utility>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <iterator>
 
 #include <Ark/VM/Types.hpp>
 #include <Ark/VM/Closure.hpp>
@@ -22,7 +25,7 @@ namespace Ark
 
 namespace Ark::internal
 {
-    enum class ValueType
+    enum class ValueType : uint8_t
     {
         List,
         Number,
@@ -31,22 +34,39 @@ namespace Ark::internal
         NFT,
         CProc,
         Closure,
-        User
+        User,
+        Coroutine
     };
 
     class Frame;
+    class Coroutine;
+
+    // the VM running on the current thread, used by Value::resolve to call functions
+    // given to plugins
+    struct ExecutionContext
+    {
+        Ark::VM_t<false>* vmf = nullptr;
+        Ark::VM_t<true>* vmt = nullptr;
+    };
+
+    extern thread_local ExecutionContext execution_context;
+
+    class ArgsView;
 
     class Value
     {
     public:
+        // functions binded by the host and functions from plugins
         using ProcType = std::function<Value (std::vector<Value>&)>;
+        // builtins: a plain function, given a view on its arguments which stay on the VM stack
+        using NativeProcType = Value (*)(ArgsView args, ExecutionContext& context);
         using Iterator = std::vector<Value>::const_iterator;
-        using Value_t = std::variant<double, std::string, PageAddr_t, NFT, ProcType, Closure, UserType, std::vector<Value>>;
 
         Value();
 
         Value(ValueType type);
         Value(int value);
+        Value(int64_t value);
         Value(float value);
         Value(double value);
         Value(const std::string& value);
@@ -54,9 +74,17 @@ namespace Ark::internal
         Value(PageAddr_t value);
         Value(NFT value);
         Value(Value::ProcType value);
+        Value(Value::NativeProcType value);
         Value(std::vector<Value>&& value);
         Value(Closure&& value);
         Value(UserType&& value);
+        Value(Coroutine&& value);
+
+        inline Value(const Value& value);
+        inline Value(Value&& value) noexcept;
+        inline Value& operator=(const Value& value);
+        inline Value& operator=(Value&& value) noexcept;
+        inline ~Value();
 
         inline ValueType valueType() const
         {
@@ -70,24 +98,39 @@ namespace Ark::internal
 
         inline double number() const
         {
-            return std::get<double>(m_value);
+            return m_integral ? static_cast<double>(m_integer) : m_number;
+        }
+
+        // integral numbers are stored as integers, until an operation gives a non integral result
+        // or overflows
+        inline bool isInteger() const
+        {
+            return m_type == ValueType::Number && m_integral;
+        }
+
+        inline int64_t integer() const
+        {
+            return m_integer;
         }
 
         inline const std::string& string() const
         {
-            return std::get<std::string>(m_value);
+            return data<std::string>();
         }
 
         inline const std::vector<Value>& const_list() const
         {
-            return std::get<std::vector<Value>>(m_value);
+            return data<std::vector<Value>>();
         }
 
         inline const UserType& usertype() const
         {
-            return std::get<UserType>(m_value);
+            return data<UserType>();
         }
 
+        // defined with the Coroutine class
+        inline const Coroutine& coroutine() const;
+
         std::vector<Value>& list();
         std::string& string_ref();
         UserType& usertype_ref();
@@ -100,46 +143,249 @@ namespace Ark::internal
 
         friend std::ostream& operator<<(std::ostream& os, const Value& V);
         friend inline bool operator==(const Value& A, const Value& B);
-        friend inline bool operator<(const Value& A, const Value& B);
+        friend bool operator<(const Value& A, const Value& B);
         friend inline bool operator!(const Value& A);
 
         template<bool D> friend class Ark::VM_t;
+        friend class GC;
 
     private:
-        Value_t m_value;
+        // heap storage for the types which can not fit in a Value, shared
+        // between copies of a Value and detached before being modified
+        struct Cell
+        {
+            std::atomic<uint32_t> refcount;
+
+            Cell() : refcount(1) {}
+        };
+
+        template <typename T>
+        struct Cell_t : public Cell
+        {
+            T data;
+
+            template <typename... Args>
+            explicit Cell_t(Args&&... args) :
+                data(std::forward<Args>(args)...)
+            {}
+        };
+
+        // a CProc is either a builtin or a function which takes its arguments in a vector
+        struct Procedure
+        {
+            NativeProcType native = nullptr;
+            ProcType function;
+        };
+
+        // types stored in a Cell: List, String, CProc, Closure, User, Coroutine
+        static constexpr unsigned CellTypes = (1 << 0) | (1 << 2) | (1 << 5) | (1 << 6) | (1 << 7) | (1 << 8);
+
+        union
+        {
+            uint64_t m_bits;
+            double m_number;
+            int64_t m_integer;
+            PageAddr_t m_page_addr;
+            NFT m_nft;
+            Cell* m_cell;
+        };
         ValueType m_type;
         bool m_const;
-        Ark::VM_t<false>* m_vmf = nullptr;
-        Ark::VM_t<true>* m_vmt = nullptr;
+        bool m_integral = false;  // for a Number, tells if it is stored in m_integer or in m_number
+
+        inline bool isCell() const
+        {
+            return (1u << static_cast<unsigned>(m_type)) & CellTypes;
+        }
+
+        template <typename T>
+        inline const T& data() const
+        {
+            return static_cast<Cell_t<T>*>(m_cell)->data;
+        }
+
+        template <typename T>
+        T& mutableData();
+
+        void copyCell();
+        void releaseCell();
+        static bool cellsEqual(const Value& A, const Value& B);
 
         inline PageAddr_t pageAddr() const
         {
-            return std::get<PageAddr_t>(m_value);
+            return m_page_addr;
         }
 
         inline NFT nft() const
         {
-            return std::get<NFT>(m_value);
+            return m_nft;
         }
 
-        inline const ProcType& proc() const
+        inline const Procedure& proc() const
         {
-            return std::get<Value::ProcType>(m_value);
+            return data<Procedure>();
         }
 
         inline const Closure& closure() const
         {
-            return std::get<Closure>(m_value);
+            return data<Closure>();
+        }
+
+        // closures are never modified once created, no need to detach them
+        inline Closure& closure_ref()
+        {
+            return static_cast<Cell_t<Closure>*>(m_cell)->data;
+        }
+
+        // defined with the Coroutine class. Coroutines are modified in place, for every copy
+        inline Coroutine& coroutine_ref();
+    };
+
+    // non-owning view on the arguments given to a builtin. They are read from the VM stack each time,
+    // so that the view stays valid if the builtin calls the VM, which could grow its stack
+    class ArgsView
+    {
+    public:
+        ArgsView(std::vector<Value>& storage, std::size_t first, std::size_t size) :
+            m_storage(&storage), m_first(first), m_size(size)
+        {}
+
+        inline std::size_t size() const
+        {
+            return m_size;
+        }
+
+        inline bool empty() const
+        {
+            return m_size == 0;
+        }
+
+        inline Value& operator[](std::size_t i)
+        {
+            return (*m_storage)[m_first + i];
+        }
+
+        inline const Value& operator[](std::size_t i) const
+        {
+            return (*m_storage)[m_first + i];
+        }
+
+        // iterators go through the view as operator[] does, and not through pointers in the stack:
+        // they stay valid as well if the builtin calls the VM while iterating
+        class iterator
+        {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Value;
+            using difference_type = std::ptrdiff_t;
+            using pointer = Value*;
+            using reference = Value&;
+
+            iterator(ArgsView* view, std::size_t i) :
+                m_view(view), m_i(i)
+            {}
+
+            inline Value& operator*() const
+            {
+                return (*m_view)[m_i];
+            }
+
+            inline Value* operator->() const
+            {
+                return &(*m_view)[m_i];
+            }
+
+            inline iterator& operator++()
+            {
+                ++m_i;
+                return *this;
+            }
+
+            inline iterator operator++(int)
+            {
+                iterator it = *this;
+                ++m_i;
+                return it;
+            }
+
+            inline iterator operator+(std::size_t n) const
+            {
+                return iterator(m_view, m_i + n);
+            }
+
+            inline bool operator==(const iterator& other) const
+            {
+                return m_i == other.m_i;
+            }
+
+            inline bool operator!=(const iterator& other) const
+            {
+                return m_i != other.m_i;
+            }
+
+        private:
+            ArgsView* m_view;
+            std::size_t m_i;
+        };
+
+        inline iterator begin()
+        {
+            return iterator(this, 0);
+        }
+
+        inline iterator end()
+        {
+            return iterator(this, m_size);
         }
 
-        Closure& closure_ref();
-        void registerVM(Ark::VM_t<false>* vm);
-        void registerVM(Ark::VM_t<true>* vm);
+    private:
+        std::vector<Value>* m_storage;
+        std::size_t m_first;
+        std::size_t m_size;
     };
 
-    inline bool operator==(const Value::ProcType& f, const Value::ProcType& g)
+    inline Value::Value(const Value& value) :
+        m_bits(value.m_bits), m_type(value.m_type), m_const(value.m_const), m_integral(value.m_integral)
+    {
+        if (isCell())
+            copyCell();
+    }
+
+    inline Value::Value(Value&& value) noexcept :
+        m_bits(value.m_bits), m_type(value.m_type), m_const(value.m_const), m_integral(value.m_integral)
+    {
+        value.m_bits = 0;
+        value.m_type = ValueType::NFT;
+        value.m_nft = NFT::Undefined;
+    }
+
+    inline Value& Value::operator=(const Value& value)
+    {
+        if (this != &value)
+        {
+            // the old value is released after the copy, since the new one could be owned by it
+            Value copy(value);
+            *this = std::move(copy);
+        }
+        return *this;
+    }
+
+    inline Value& Value::operator=(Value&& value) noexcept
+    {
+        if (this != &value)
+        {
+            std::swap(m_bits, value.m_bits);
+            std::swap(m_type, value.m_type);
+            std::swap(m_integral, value.m_integral);
+            m_const = value.m_const;
+        }
+        return *this;
+    }
+
+    inline Value::~Value()
     {
-        return f.template target<Value (const std::vector<Value>&)>() == g.template target<Value (const std::vector<Value>&)>();
+        if (isCell())
+            releaseCell();
     }
 
     inline bool operator==(const Value& A, const Value& B)
@@ -147,22 +393,113 @@ namespace Ark::internal
         // values should have the same type
         if (A.m_type != B.m_type)
             return false;
-        
-        return A.m_value == B.m_value;
-    }
 
-    inline bool operator<(const Value& A, const Value& B)
-    {
-        if (A.m_type != B.m_type)
-            return (static_cast<int>(A.m_type) - static_cast<int>(B.m_type)) < 0;
-        return A.m_value < B.m_value;
+        // values stored inline are compared directly, the unused bytes being always zeroed
+        if (A.m_type == ValueType::Number)
+        {
+            if (A.m_integral && B.m_integral)
+                return A.m_integer == B.m_integer;
+            return A.number() == B.number();
+        }
+        else if (!A.isCell())
+            return A.m_bits == B.m_bits;
+        return Value::cellsEqual(A, B);
     }
 
+    bool operator<(const Value& A, const Value& B);
+
     inline bool operator!=(const Value& A, const Value& B)
     {
         return !(A == B);
     }
 
+    // ------------------------------------------
+    //     arithmetic and comparison of Numbers
+    // ------------------------------------------
+
+    // a number read from a string or from the bytecode is stored as an integer if it is one
+    inline Value integralOrDouble(double value)
+    {
+        constexpr double max_exact_integer = 9007199254740992.0;  // 2^53
+
+        if (value == 0.0 && std::signbit(value))
+            return Value(value);  // -0 has no integer counterpart
+        if (-max_exact_integer <= value && value <= max_exact_integer &&
+            value == static_cast<double>(static_cast<int64_t>(value)))
+            return Value(static_cast<int64_t>(value));
+        return Value(value);
+    }
+
+    // the integer operations return true on overflow
+    inline bool addOverflows(int64_t a, int64_t b, int64_t* result)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_add_overflow(a, b, result);
+#else
+        if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b))
+            return true;
+        *result = a + b;
+        return false;
+#endif
+    }
+
+    inline bool subOverflows(int64_t a, int64_t b, int64_t* result)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_sub_overflow(a, b, result);
+#else
+        if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b))
+            return true;
+        *result = a - b;
+        return false;
+#endif
+    }
+
+    inline bool mulOverflows(int64_t a, int64_t b, int64_t* result)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_mul_overflow(a, b, result);
+#else
+        // the product computed with doubles is precise enough to know if it fits in an int64
+        if (std::fabs(static_cast<double>(a) * static_cast<double>(b)) >= 9.2e18)
+            return true;
+        *result = a * b;
+        return false;
+#endif
+    }
+
+    // A and B must be Numbers. Integers give an integer, unless the result overflows
+    inline Value addNumbers(const Value& A, const Value& B)
+    {
+        int64_t result;
+        if (A.isInteger() && B.isInteger() && !addOverflows(A.integer(), B.integer(), &result))
+            return Value(result);
+        return Value(A.number() + B.number());
+    }
+
+    inline Value subNumbers(const Value& A, const Value& B)
+    {
+        int64_t result;
+        if (A.isInteger() && B.isInteger() && !subOverflows(A.integer(), B.integer(), &result))
+            return Value(result);
+        return Value(A.number() - B.number());
+    }
+
+    inline Value mulNumbers(const Value& A, const Value& B)
+    {
+        int64_t result;
+        if (A.isInteger() && B.isInteger() && !mulOverflows(A.integer(), B.integer(), &result))
+            return Value(result);
+        return Value(A.number() * B.number());
+    }
+
+    inline bool lessNumbers(const Value& A, const Value& B)
+    {
+        if (A.isInteger() && B.isInteger())
+            return A.integer() < B.integer();
+        return A.number() < B.number();
+    }
+
     inline bool operator!(const Value& A)
     {
         switch (A.valueType())
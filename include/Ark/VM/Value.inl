@@ -1,10 +1,31 @@
 template <typename... Args>
 Value Value::resolve(Args&&... args) const
 {
-    if (m_vmf)
-        return m_vmf->resolve(this, std::forward<Args>(args)...);
-    else if (m_vmt)
-        return m_vmt->resolve(this, std::forward<Args>(args)...);
+    if (execution_context.vmf)
+        return execution_context.vmf->resolve(this, std::forward<Args>(args)...);
+    else if (execution_context.vmt)
+        return execution_context.vmt->resolve(this, std::forward<Args>(args)...);
     else
         throw std::runtime_error("Value::resolve couldn't resolve a without a VM");
-}
\ No newline at end of file
+}
+
+template <typename... Args>
+Value Callback::operator()(Args&&... args)
+{
+    if (execution_context.vmf)
+        return execution_context.vmf->callCallback(*this, std::forward<Args>(args)...);
+    else if (execution_context.vmt)
+        return execution_context.vmt->callCallback(*this, std::forward<Args>(args)...);
+    else
+        throw std::runtime_error("Callback couldn't be called without a VM");
+}
+
+inline std::vector<Value> Callback::map(const std::vector<Value>& args)
+{
+    if (execution_context.vmf)
+        return execution_context.vmf->mapCallback(*this, args);
+    else if (execution_context.vmt)
+        return execution_context.vmt->mapCallback(*this, args);
+    else
+        throw std::runtime_error("Callback couldn't be called without a VM");
+}
@@ -63,6 +63,15 @@ namespace Ark
         return timestamp;
     }
 
+    uint16_t BytecodeReader::majorVersion()
+    {
+        std::size_t i = 0;
+
+        if (!(m_bytecode.size() > 6 && m_bytecode[i++] == 'a' && m_bytecode[i++] == 'r' && m_bytecode[i++] == 'k' && m_bytecode[i++] == Instruction::NOP))
+            return 0;
+        return readNumber(i);
+    }
+
     void BytecodeReader::display()
     {
         bytecode_t b = bytecode();
@@ -180,11 +189,35 @@ namespace Ark
             os << "\n";
         }
 
+        if (b[i] == Instruction::FUNCTIONS_TABLE_START)
+        {
+            os << "Functions table:\n"; i++;
+            uint16_t size = readNumber(i); i++;
+            os << "Length: " << size << "\n";
+            for (uint16_t j=0; j < size; ++j)
+            {
+                uint16_t arity = readNumber(i); i++;
+                uint16_t locals = readNumber(i); i++;
+                uint16_t max_stack = readNumber(i); i++;
+                os << "- page " << j << ": arity " << arity << ", locals " << locals << ", stack " << max_stack << "\n";
+            }
+            os << "\n";
+        }
+
         uint16_t pp = 0;
 
         while (b[i] == Instruction::CODE_SEGMENT_START)
         {
             os << "Code segment (PP: " << pp << ") :\n"; i++;
+            uint16_t locals_count = readNumber(i); i++;
+            std::vector<std::string> locals;
+            os << "Locals:";
+            for (uint16_t j=0; j < locals_count; ++j)
+            {
+                locals.push_back(symbols[readNumber(i)]); i++;
+                os << " " << locals.back();
+            }
+            os << "\n";
             uint16_t size = readNumber(i); i++;
             os << "Length: " << size << "\n";
 
@@ -244,6 +277,11 @@ namespace Ark
                         os << "CALL " << termcolor::reset << "(" << readNumber(i) << ")\n";
                         i++;
                     }
+                    else if (inst == Instruction::TAIL_CALL)
+                    {
+                        os << "TAIL_CALL " << termcolor::reset << "(" << readNumber(i) << ")\n";
+                        i++;
+                    }
                     else if (inst == Instruction::CAPTURE)
                     {
                         os << "CAPTURE " << termcolor::reset << symbols[readNumber(i)] << "\n";
@@ -268,7 +306,32 @@ namespace Ark
                         os << "SAVE_ENV\n";
                     else if (inst == Instruction::GET_FIELD)
                     {
-                        os << "GET_FIELD " << termcolor::green << symbols[readNumber(i)] << "\n";
+                        os << "GET_FIELD " << termcolor::green << symbols[readNumber(i)];
+                        i++;
+                        uint16_t slot = readNumber(i);
+                        i++;
+                        if (slot != 0xffff)
+                            os << termcolor::reset << " (slot " << slot << ")";
+                        os << "\n";
+                    }
+                    else if (inst == Instruction::LOAD_LOCAL)
+                    {
+                        os << "LOAD_LOCAL " << termcolor::green << locals[readNumber(i)] << "\n";
+                        i++;
+                    }
+                    else if (inst == Instruction::STORE_LOCAL)
+                    {
+                        os << "STORE_LOCAL " << termcolor::green << locals[readNumber(i)] << "\n";
+                        i++;
+                    }
+                    else if (inst == Instruction::LET_LOCAL)
+                    {
+                        os << "LET_LOCAL " << termcolor::green << locals[readNumber(i)] << "\n";
+                        i++;
+                    }
+                    else if (inst == Instruction::MUT_LOCAL)
+                    {
+                        os << "MUT_LOCAL " << termcolor::green << locals[readNumber(i)] << "\n";
                         i++;
                     }
                     else if (inst == Instruction::ADD)
@@ -321,6 +384,43 @@ namespace Ark
                         os << "TYPE\n";
                     else if (inst == Instruction::HASFIELD)
                         os << "HASFIELD\n";
+                    else if (inst == Instruction::NOT)
+                        os << "NOT\n";
+                    else if (inst == Instruction::YIELD)
+                        os << "YIELD\n";
+                    else if (inst == Instruction::RESUME)
+                        os << "RESUME\n";
+                    else if (inst == Instruction::INCREMENT || inst == Instruction::DECREMENT)
+                    {
+                        os << (inst == Instruction::INCREMENT ? "INCREMENT " : "DECREMENT ") << termcolor::green << symbols[readNumber(i)];
+                        i++;
+                        os << " " << termcolor::magenta << values[readNumber(i) & ~ConstantFirst] << "\n";
+                        i++;
+                    }
+                    else if (inst == Instruction::INCREMENT_LOCAL || inst == Instruction::DECREMENT_LOCAL)
+                    {
+                        os << (inst == Instruction::INCREMENT_LOCAL ? "INCREMENT_LOCAL " : "DECREMENT_LOCAL ") << termcolor::green << locals[readNumber(i)];
+                        i++;
+                        os << " " << termcolor::magenta << values[readNumber(i) & ~ConstantFirst] << "\n";
+                        i++;
+                    }
+                    else if (inst == Instruction::ADD_CONST || inst == Instruction::SUB_CONST)
+                    {
+                        os << (inst == Instruction::ADD_CONST ? "ADD_CONST " : "SUB_CONST ") << termcolor::magenta << values[readNumber(i)] << "\n";
+                        i++;
+                    }
+                    else if (inst == Instruction::CALL_BUILTIN)
+                    {
+                        os << "CALL_BUILTIN " << termcolor::reset << FFI::builtins[readNumber(i)].first;
+                        i++;
+                        os << " (" << readNumber(i) << ")\n";
+                        i++;
+                    }
+                    else if (Instruction::GT_JUMP_IF_FALSE <= inst && inst <= Instruction::EQ_JUMP_IF_FALSE)
+                    {
+                        os << instructionName(inst) << " " << termcolor::red << "(" << readNumber(i) << ")\n";
+                        i++;
+                    }
                     else
                     {
                         os << "Unknown instruction: " << static_cast<int>(inst) << "\n";
@@ -337,6 +437,43 @@ namespace Ark
             if (i == b.size())
                 break;
         }
+
+        if (i < b.size() && b[i] == Instruction::DEBUG_TABLE_START)
+        {
+            os << "Debug information:\n"; i++;
+            uint16_t files_count = readNumber(i); i++;
+            std::vector<std::string> files;
+            for (uint16_t j=0; j < files_count; ++j)
+            {
+                std::string content = "";
+                while (b[i] != 0)
+                    content += b[i++];
+                i++;
+                files.push_back(content);
+            }
+
+            uint16_t pages_count = readNumber(i); i++;
+            for (uint16_t j=0; j < pages_count; ++j)
+            {
+                std::string name = "";
+                while (b[i] != 0)
+                    name += b[i++];
+                i++;
+                os << "- page " << j << (name.empty() ? "" : " (" + name + ")") << ":\n";
+
+                uint16_t count = readNumber(i); i++;
+                for (uint16_t k=0; k < count; ++k)
+                {
+                    uint16_t offset = readNumber(i); i++;
+                    uint16_t file = readNumber(i); i++;
+                    uint16_t line = readNumber(i); i++;
+                    uint16_t col = readNumber(i); i++;
+                    os << "    " << termcolor::cyan << offset << termcolor::reset << " "
+                       << (file < files.size() ? files[file] : "?") << ":" << line << ":" << col << "\n";
+                }
+            }
+            os << "\n";
+        }
     }
 
     uint16_t BytecodeReader::readNumber(std::size_t& i)
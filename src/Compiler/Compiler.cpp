@@ -11,7 +11,7 @@ namespace Ark
     using namespace Ark::internal;
 
     Compiler::Compiler(unsigned debug, const std::string& lib_dir, uint16_t options) :
-        m_parser(debug, lib_dir, options), m_options(options), m_debug(debug)
+        m_parser(debug, lib_dir, options), m_options(options), m_current_file(0), m_debug(debug)
     {}
 
     void Compiler::feed(const std::string& code, const std::string& filename)
@@ -86,6 +86,11 @@ namespace Ark
                 Ark::logger.info("Compiling");
             // gather symbols, values, and start to create code segments
             m_code_pages.emplace_back();  // create empty page
+            m_locals.emplace_back();
+            m_arities.push_back(0);
+            m_locations.emplace_back();
+            m_page_names.emplace_back();
+            collectFieldSlots(m_parser.ast());
             _compile(m_parser.ast(), 0);
         if (m_debug >= 1)
             Ark::logger.info("Adding symbols table");
@@ -154,22 +159,43 @@ namespace Ark
             m_bytecode.push_back(Instruction::NOP);
         }
 
+        if (m_debug >= 1)
+            Ark::logger.info("Adding functions table");
+
+        // functions table, so that the VM doesn't have to look into the code to know how to call a page
+        m_bytecode.push_back(Instruction::FUNCTIONS_TABLE_START);
+        // push size
+        pushNumber(static_cast<uint16_t>(m_code_pages.size()));
+        // push elements: arity, number of locals, maximum stack depth
+        for (std::size_t page_id=0; page_id < m_code_pages.size(); ++page_id)
+        {
+            pushNumber(m_arities[page_id]);
+            pushNumber(static_cast<uint16_t>(m_locals[page_id].size()));
+            pushNumber(maxStackDepth(page_id));
+        }
+
         if (m_debug >= 1)
             Ark::logger.info("Adding code segments");
 
         // start code segments
-        for (auto page : m_code_pages)
+        for (std::size_t page_id=0; page_id < m_code_pages.size(); ++page_id)
         {
+            auto& page = m_code_pages[page_id];
+
             if (m_debug >= 2)
                 Ark::logger.info("-", page.size() + 1);
 
             m_bytecode.push_back(Instruction::CODE_SEGMENT_START);
+            // push locals table
+            pushNumber(static_cast<uint16_t>(m_locals[page_id].size()));
+            for (uint16_t id : m_locals[page_id])
+                pushNumber(id);
             // push number of elements
             if (!page.size())
             {
                 pushNumber(0x01);
                 m_bytecode.push_back(Instruction::HALT);
-                return;
+                continue;
             }
             pushNumber(static_cast<uint16_t>(page.size() + 1));
 
@@ -183,9 +209,44 @@ namespace Ark
         if (!m_code_pages.size())
         {
             m_bytecode.push_back(Instruction::CODE_SEGMENT_START);
+            pushNumber(static_cast<uint16_t>(0));
             pushNumber(static_cast<uint16_t>(1));
             m_bytecode.push_back(Instruction::HALT);
         }
+
+        if (m_options & FeatureDebugInfo)
+        {
+            if (m_debug >= 1)
+                Ark::logger.info("Adding debug information");
+
+            // read by the VM only when it needs it (errors, profiler), the code segments are before it
+            m_bytecode.push_back(Instruction::DEBUG_TABLE_START);
+            // files, as null terminated strings
+            pushNumber(static_cast<uint16_t>(m_files.size()));
+            for (auto&& file : m_files)
+            {
+                for (std::size_t i=0; i < file.size(); ++i)
+                    m_bytecode.push_back(file[i]);
+                m_bytecode.push_back(Instruction::NOP);
+            }
+            // for each page: name (null terminated, empty if unknown), then the locations of its instructions
+            pushNumber(static_cast<uint16_t>(m_code_pages.size()));
+            for (std::size_t page_id=0; page_id < m_code_pages.size(); ++page_id)
+            {
+                for (std::size_t i=0; i < m_page_names[page_id].size(); ++i)
+                    m_bytecode.push_back(m_page_names[page_id][i]);
+                m_bytecode.push_back(Instruction::NOP);
+
+                pushNumber(static_cast<uint16_t>(m_locations[page_id].size()));
+                for (const Location& loc : m_locations[page_id])
+                {
+                    pushNumber(loc.offset);
+                    pushNumber(loc.file);
+                    pushNumber(loc.line);
+                    pushNumber(loc.col);
+                }
+            }
+        }
     }
 
     void Compiler::saveTo(const std::string& file)
@@ -203,10 +264,22 @@ namespace Ark
         return m_bytecode;
     }
 
-    void Compiler::_compile(Ark::internal::Node x, int p)
+    void Compiler::_compile(Ark::internal::Node x, int p, bool is_terminal)
     {
         if (m_debug >= 2)
             Ark::logger.info(x);
+
+        // the root of a file (the program or an imported file) gives the file of its nodes
+        if (!x.filename().empty())
+        {
+            uint16_t previous_file = m_current_file;
+            m_current_file = addFile(x.filename());
+            x.setFilename("");
+            _compile(x, p, is_terminal);
+            m_current_file = previous_file;
+            return;
+        }
+        markLocation(x, p);
         
         // register symbols
         if (x.nodeType() == Ark::internal::NodeType::Symbol)
@@ -224,12 +297,7 @@ namespace Ark
                 page(p).emplace_back(static_cast<Instruction>(Instruction::FIRST_OPERATOR + it_operator.value()));
             }
             else
-            {
-                std::size_t i = addSymbol(name);
-
-                page(p).emplace_back(Instruction::LOAD_SYMBOL);
-                pushNumber(static_cast<uint16_t>(i), &page(p));
-            }
+                pushVariableInstruction(Instruction::LOAD_SYMBOL, Instruction::LOAD_LOCAL, name, p);
 
             return;
         }
@@ -238,9 +306,13 @@ namespace Ark
             std::string name = x.string();
             // 'name' shouldn't be a builtin/operator, we can use it as-is
             std::size_t i = addSymbol(name);
-            
+            // slot of the field in the closure environment, checked by the VM. An invalid slot
+            // makes it look for the field by symbol id
+            auto slot = m_field_slots.find(name);
+
             page(p).emplace_back(Instruction::GET_FIELD);
             pushNumber(static_cast<uint16_t>(i), &page(p));
+            pushNumber(slot != m_field_slots.end() ? slot->second : static_cast<uint16_t>(0xffff), &page(p));
 
             return;
         }
@@ -269,6 +341,27 @@ namespace Ark
 
             if (n == Ark::internal::Keyword::If)
             {
+                // comparisons are fused with the jump to the else code
+                if (compileConditionalJump(x.list()[1], p))
+                {
+                    std::size_t jump_to_else_pos = page(p).size() - 2;
+                        // if code
+                        _compile(x.list()[2], p, is_terminal);
+                        // when if is finished, jump to end
+                        page(p).emplace_back(Instruction::JUMP);
+                        std::size_t jump_to_end_pos = page(p).size();
+                        pushNumber(static_cast<uint16_t>(0x00), &page(p));
+                    // set jump to else pos
+                    page(p)[jump_to_else_pos]     = (static_cast<uint16_t>(page(p).size()) & 0xff00) >> 8;
+                    page(p)[jump_to_else_pos + 1] =  static_cast<uint16_t>(page(p).size()) & 0x00ff;
+                    // else code
+                    _compile(x.list()[3], p, is_terminal);
+                    // set jump to end pos
+                    page(p)[jump_to_end_pos]     = (static_cast<uint16_t>(page(p).size()) & 0xff00) >> 8;
+                    page(p)[jump_to_end_pos + 1] =  static_cast<uint16_t>(page(p).size()) & 0x00ff;
+                    return;
+                }
+
                 // compile condition
                 _compile(x.list()[1], p);
                 // jump only if needed to the x.list()[2] part
@@ -277,7 +370,7 @@ namespace Ark
                 // absolute address to jump to if condition is true
                 pushNumber(static_cast<uint16_t>(0x00), &page(p));
                     // else code
-                    _compile(x.list()[3], p);
+                    _compile(x.list()[3], p, is_terminal);
                     // when else is finished, jump to end
                     page(p).emplace_back(Instruction::JUMP);
                     std::size_t jump_to_end_pos = page(p).size();
@@ -286,7 +379,7 @@ namespace Ark
                 page(p)[jump_to_if_pos]     = (static_cast<uint16_t>(page(p).size()) & 0xff00) >> 8;
                 page(p)[jump_to_if_pos + 1] =  static_cast<uint16_t>(page(p).size()) & 0x00ff;
                 // if code
-                _compile(x.list()[2], p);
+                _compile(x.list()[2], p, is_terminal);
                 // set jump to end pos
                 page(p)[jump_to_end_pos]     = (static_cast<uint16_t>(page(p).size()) & 0xff00) >> 8;
                 page(p)[jump_to_end_pos + 1] =  static_cast<uint16_t>(page(p).size()) & 0x00ff;
@@ -294,35 +387,41 @@ namespace Ark
             else if (n == Ark::internal::Keyword::Set)
             {
                 std::string name = x.list()[1].string();
-                std::size_t i = addSymbol(name);
+
+                if (compileIncrement(name, x.list()[2], p))
+                    return;
 
                 // put value before symbol id
+                std::size_t function_page = m_code_pages.size();
                 _compile(x.list()[2], p);
+                nameFunctionPage(name, x.list()[2], function_page);
 
-                page(p).emplace_back(Instruction::STORE);
-                pushNumber(static_cast<uint16_t>(i), &page(p));
+                markLocation(x, p);
+                pushVariableInstruction(Instruction::STORE, Instruction::STORE_LOCAL, name, p);
             }
             else if (n == Ark::internal::Keyword::Let)
             {
                 std::string name = x.list()[1].string();
-                std::size_t i = addSymbol(name);
 
                 // put value before symbol id
+                std::size_t function_page = m_code_pages.size();
                 _compile(x.list()[2], p);
+                nameFunctionPage(name, x.list()[2], function_page);
 
-                page(p).emplace_back(Instruction::LET);
-                pushNumber(static_cast<uint16_t>(i), &page(p));
+                markLocation(x, p);
+                pushVariableInstruction(Instruction::LET, Instruction::LET_LOCAL, name, p);
             }
             else if (n == Ark::internal::Keyword::Mut)
             {
                 std::string name = x.list()[1].string();
-                std::size_t i = addSymbol(name);
 
                 // put value before symbol id
+                std::size_t function_page = m_code_pages.size();
                 _compile(x.list()[2], p);
+                nameFunctionPage(name, x.list()[2], function_page);
 
-                page(p).emplace_back(Instruction::MUT);
-                pushNumber(static_cast<uint16_t>(i), &page(p));
+                markLocation(x, p);
+                pushVariableInstruction(Instruction::MUT, Instruction::MUT_LOCAL, name, p);
             }
             else if (n == Ark::internal::Keyword::Fun)
             {
@@ -339,41 +438,57 @@ namespace Ark
                 // create new page for function body
                 m_code_pages.emplace_back();
                 std::size_t page_id = m_code_pages.size() - 1;
+                // its locals are the arguments, then the variables defined in the body
+                m_locals.emplace_back();
+                m_arities.push_back(0);
+                m_locations.emplace_back();
+                m_page_names.emplace_back();
+                for (Ark::internal::Node::Iterator it=x.list()[1].list().begin(); it != x.list()[1].list().end(); ++it)
+                {
+                    if (it->nodeType() == NodeType::Symbol)
+                    {
+                        m_arities[page_id]++;
+                        uint16_t var_id = static_cast<uint16_t>(addSymbol(it->string()));
+                        if (std::find(m_locals[page_id].begin(), m_locals[page_id].end(), var_id) == m_locals[page_id].end())
+                            m_locals[page_id].push_back(var_id);
+                    }
+                }
+                collectLocals(x.list()[2], m_locals[page_id]);
                 // load value on the stack
                 page(p).emplace_back(Instruction::LOAD_CONST);
                 std::size_t id = addValue(page_id);  // save page_id into the constants table as PageAddr
                 pushNumber(static_cast<uint16_t>(id), &page(p));
-                // pushing arguments from the stack into variables in the new scope
-                for (Ark::internal::Node::Iterator it=x.list()[1].list().begin(); it != x.list()[1].list().end(); ++it)
+                // pushing arguments from the stack into variables in the new scope, the last
+                // argument being on top of the stack
+                for (auto it=x.list()[1].list().rbegin(); it != x.list()[1].list().rend(); ++it)
                 {
                     if (it->nodeType() == NodeType::Symbol)
-                    {
-                        page(page_id).emplace_back(Instruction::MUT);
-                        std::size_t var_id = addSymbol(it->string());
-                        pushNumber(static_cast<uint16_t>(var_id), &(page(page_id)));
-                    }
+                        pushVariableInstruction(Instruction::MUT, Instruction::MUT_LOCAL, it->string(), page_id);
                 }
                 // push body of the function
-                _compile(x.list()[2], page_id);
+                _compile(x.list()[2], page_id, /* is_terminal */ true);
                 // return last value on the stack
+                markLocation(x, static_cast<int>(page_id));
                 page(page_id).emplace_back(Instruction::RET);
             }
             else if (n == Ark::internal::Keyword::Begin)
             {
                 for (std::size_t i=1; i < x.list().size(); ++i)
-                    _compile(x.list()[i], p);
+                    _compile(x.list()[i], p, is_terminal && i + 1 == x.list().size());
             }
             else if (n == Ark::internal::Keyword::While)
             {
                 // save current position to jump there at the end of the loop
                 std::size_t current = page(p).size();
-                // push condition
-                _compile(x.list()[1], p);
-                // absolute jump to end of block if condition is false
-                page(p).emplace_back(Instruction::POP_JUMP_IF_FALSE);
-                std::size_t jump_to_end_pos = page(p).size();
-                // absolute address to jump to if condition is false
-                pushNumber(static_cast<uint16_t>(0x00), &page(p));
+                // push condition, and absolute jump to end of block if condition is false
+                if (!compileConditionalJump(x.list()[1], p))
+                {
+                    _compile(x.list()[1], p);
+                    page(p).emplace_back(Instruction::POP_JUMP_IF_FALSE);
+                    // absolute address to jump to if condition is false
+                    pushNumber(static_cast<uint16_t>(0x00), &page(p));
+                }
+                std::size_t jump_to_end_pos = page(p).size() - 2;
                 // push code to page
                     _compile(x.list()[2], p);
                     // loop, jump to the condition
@@ -397,6 +512,11 @@ namespace Ark
                 // create new page for quoted code
                 m_code_pages.emplace_back();
                 std::size_t page_id = m_code_pages.size() - 1;
+                m_locals.emplace_back();
+                m_arities.push_back(0);
+                m_locations.emplace_back();
+                m_page_names.emplace_back();
+                collectLocals(x.list()[1], m_locals[page_id]);
                 _compile(x.list()[1], page_id);
                 page(page_id).emplace_back(Instruction::RET);  // return to the last frame
 
@@ -422,6 +542,7 @@ namespace Ark
         // if we are here, we should have a function name
         // push arguments first, then function name, then call it
             m_temp_pages.emplace_back();
+            m_temp_pages_owner.push_back((p >= 0) ? static_cast<std::size_t>(p) : m_temp_pages_owner[-p - 1]);
             int proc_page = -static_cast<int>(m_temp_pages.size());
             _compile(x.list()[0], proc_page);  // storing proc
             // trying to handle chained closure.field.field.field...
@@ -444,13 +565,33 @@ namespace Ark
             // push arguments on current page
             for (Ark::internal::Node::Iterator exp=x.list().begin() + n; exp != x.list().end(); ++exp)
                 _compile(*exp, p);
-            // push proc from temp page
-            for (auto&& inst : m_temp_pages.back())
-                page(p).push_back(inst);
+            // a call in tail position can reuse the frame of the current function, except
+            // for builtins (they don't have one) and closures fields (which need their closure
+            // environment until they return)
+            bool builtin = n == 1 && m_temp_pages.back()[0].inst == Instruction::BUILTIN;
+            bool tail_call = is_terminal && n == 1 && !builtin;
+
+            // the call itself, and the function (compiled in the temporary page) come from the node
+            markLocation(x, p);
+
+            if (builtin)
+            {
+                // builtins are called directly by their id, instead of pushing them first
+                page(p).emplace_back(Instruction::CALL_BUILTIN);
+                page(p).push_back(m_temp_pages.back()[1]);
+                page(p).push_back(m_temp_pages.back()[2]);
+            }
+            else
+            {
+                // push proc from temp page
+                for (auto&& inst : m_temp_pages.back())
+                    page(p).push_back(inst);
+                // call the procedure
+                page(p).push_back(tail_call ? Instruction::TAIL_CALL : Instruction::CALL);
+            }
             m_temp_pages.pop_back();
+            m_temp_pages_owner.pop_back();
 
-            // call the procedure
-            page(p).push_back(Instruction::CALL);
             // number of arguments
             std::size_t args_count = 0;
             for (auto it=x.list().begin() + 1; it != x.list().end(); ++it)
@@ -466,6 +607,18 @@ namespace Ark
             // retrieve operator
             auto op_inst = m_temp_pages.back()[0];
             m_temp_pages.pop_back();
+            m_temp_pages_owner.pop_back();
+
+            // (+ a 1) and (- a 1) take their constant from the instruction
+            if ((op_inst.inst == Instruction::ADD || op_inst.inst == Instruction::SUB) && n == 1 &&
+                x.list().size() == 3 && x.list()[2].nodeType() == Ark::internal::NodeType::Number)
+            {
+                _compile(x.list()[1], p);
+
+                page(p).emplace_back(op_inst.inst == Instruction::ADD ? Instruction::ADD_CONST : Instruction::SUB_CONST);
+                pushNumber(static_cast<uint16_t>(addValue(x.list()[2])), &page(p));
+                return;
+            }
 
             // push arguments on current page
             std::size_t exp_count = 0;
@@ -482,11 +635,17 @@ namespace Ark
                 // in order to be able to handle things like (op A B C D...)
                 // which should be transformed into A B op C op D op...
                 if (exp_count >= 2)
+                {
+                    markLocation(x, p);
                     page(p).push_back(op_inst);
+                }
             }
 
             if (exp_count == 1)
+            {
+                markLocation(x, p);
                 page(p).push_back(op_inst);
+            }
 
             // need to check we didn't push the (op A B C D...) things for operators not supporting it
             if (exp_count > 2)
@@ -514,6 +673,341 @@ namespace Ark
         return;
     }
 
+    void Compiler::collectLocals(const Ark::internal::Node& x, std::vector<uint16_t>& locals)
+    {
+        if (x.nodeType() != Ark::internal::NodeType::List || x.const_list().empty())
+            return;
+
+        if (x.const_list()[0].nodeType() == Ark::internal::NodeType::Keyword)
+        {
+            Ark::internal::Keyword n = x.const_list()[0].keyword();
+
+            // functions and quoted code are compiled in their own pages, with their own locals
+            if (n == Ark::internal::Keyword::Fun || n == Ark::internal::Keyword::Quote)
+                return;
+            else if (n == Ark::internal::Keyword::Let || n == Ark::internal::Keyword::Mut)
+            {
+                uint16_t id = static_cast<uint16_t>(addSymbol(x.const_list()[1].string()));
+                if (std::find(locals.begin(), locals.end(), id) == locals.end())
+                    locals.push_back(id);
+            }
+        }
+
+        for (const Ark::internal::Node& node : x.const_list())
+            collectLocals(node, locals);
+    }
+
+    void Compiler::collectFieldSlots(const Ark::internal::Node& x)
+    {
+        if (x.nodeType() != Ark::internal::NodeType::List || x.const_list().empty())
+            return;
+
+        if (x.const_list()[0].nodeType() == Ark::internal::NodeType::Keyword &&
+            x.const_list()[0].keyword() == Ark::internal::Keyword::Fun)
+        {
+            // the environment of a closure holds its captured variables, in the order of the captures
+            std::vector<std::string> captures;
+            for (const Ark::internal::Node& arg : x.const_list()[1].const_list())
+            {
+                if (arg.nodeType() != Ark::internal::NodeType::Capture ||
+                    std::find(captures.begin(), captures.end(), arg.string()) != captures.end())
+                    continue;
+
+                uint16_t slot = static_cast<uint16_t>(captures.size());
+                captures.push_back(arg.string());
+
+                auto it = m_field_slots.find(arg.string());
+                if (it == m_field_slots.end())
+                    m_field_slots.emplace(arg.string(), slot);
+                else if (it->second != slot)
+                    it->second = 0xffff;
+            }
+        }
+
+        for (const Ark::internal::Node& node : x.const_list())
+            collectFieldSlots(node);
+    }
+
+    void Compiler::pushVariableInstruction(Instruction inst, Instruction local_inst, const std::string& name, int p)
+    {
+        // variables local to the current function are addressed by their slot in its scope
+        if (auto slot = localSlot(name, p))
+        {
+            page(p).emplace_back(local_inst);
+            pushNumber(static_cast<uint16_t>(slot.value()), &page(p));
+        }
+        else
+        {
+            std::size_t i = addSymbol(name);
+
+            page(p).emplace_back(inst);
+            pushNumber(static_cast<uint16_t>(i), &page(p));
+        }
+    }
+
+    void Compiler::markLocation(const Ark::internal::Node& x, int p)
+    {
+        // the temporary pages are copied in their owner page, after the location of the call is marked
+        if (p < 0 || x.line() == 0 || !(m_options & FeatureDebugInfo))
+            return;
+
+        auto clamp = [](std::size_t n) -> uint16_t {
+            return static_cast<uint16_t>(std::min<std::size_t>(n, 65535));
+        };
+        Location loc { clamp(page(p).size()), m_current_file, clamp(x.line()), clamp(x.col()) };
+
+        std::vector<Location>& locations = m_locations[p];
+        if (!locations.empty())
+        {
+            Location& last = locations.back();
+            if (last.file == loc.file && last.line == loc.line && last.col == loc.col)
+                return;
+            // nothing was emitted since the last node, it's the more precise one
+            if (last.offset == loc.offset)
+            {
+                last = loc;
+                return;
+            }
+        }
+        locations.push_back(loc);
+    }
+
+    void Compiler::nameFunctionPage(const std::string& name, const Ark::internal::Node& value, std::size_t page_id)
+    {
+        // (let name (fun ...)) creates the page page_id, the first one created while compiling the value
+        if (value.nodeType() == Ark::internal::NodeType::List && value.const_list().size() > 0 &&
+            value.const_list()[0].nodeType() == Ark::internal::NodeType::Keyword &&
+            value.const_list()[0].keyword() == Ark::internal::Keyword::Fun &&
+            page_id < m_page_names.size() && m_page_names[page_id].empty())
+            m_page_names[page_id] = name;
+    }
+
+    uint16_t Compiler::addFile(const std::string& filename)
+    {
+        auto it = std::find(m_files.begin(), m_files.end(), filename);
+        if (it != m_files.end())
+            return static_cast<uint16_t>(std::distance(m_files.begin(), it));
+
+        m_files.push_back(filename);
+        return static_cast<uint16_t>(m_files.size() - 1);
+    }
+
+    bool Compiler::compileIncrement(const std::string& name, const Ark::internal::Node& value, int p)
+    {
+        // (set a (+ a 1)), (set a (+ 1 a)) and (set a (- a 1))
+        if (value.nodeType() != Ark::internal::NodeType::List || value.const_list().size() != 3)
+            return false;
+
+        auto op = operatorInstruction(value.const_list()[0]);
+        if (!op || (op.value() != Instruction::ADD && op.value() != Instruction::SUB))
+            return false;
+
+        auto is_variable = [&name](const Ark::internal::Node& node) -> bool {
+            return node.nodeType() == Ark::internal::NodeType::Symbol && node.string() == name;
+        };
+        auto is_number = [](const Ark::internal::Node& node) -> bool {
+            return node.nodeType() == Ark::internal::NodeType::Number;
+        };
+
+        const Ark::internal::Node* constant = nullptr;
+        bool constant_first = false;
+        if (is_variable(value.const_list()[1]) && is_number(value.const_list()[2]))
+            constant = &value.const_list()[2];
+        else if (op.value() == Instruction::ADD && is_number(value.const_list()[1]) && is_variable(value.const_list()[2]))
+        {
+            constant = &value.const_list()[1];
+            constant_first = true;
+        }
+        else
+            return false;
+
+        // the VM needs the order of the operands to raise the same errors as ADD
+        uint16_t constant_id = static_cast<uint16_t>(addValue(*constant));
+        if (constant_id >= ConstantFirst)
+            return false;
+        if (constant_first)
+            constant_id |= ConstantFirst;
+
+        bool increment = op.value() == Instruction::ADD;
+        if (auto slot = localSlot(name, p))
+        {
+            page(p).emplace_back(increment ? Instruction::INCREMENT_LOCAL : Instruction::DECREMENT_LOCAL);
+            pushNumber(static_cast<uint16_t>(slot.value()), &page(p));
+        }
+        else
+        {
+            page(p).emplace_back(increment ? Instruction::INCREMENT : Instruction::DECREMENT);
+            pushNumber(static_cast<uint16_t>(addSymbol(name)), &page(p));
+        }
+        pushNumber(constant_id, &page(p));
+
+        return true;
+    }
+
+    bool Compiler::compileConditionalJump(const Ark::internal::Node& condition, int p)
+    {
+        // (op a b), op being a comparison operator, is compiled to a, b, then a jump if the
+        // comparison is false. The address of the jump is left to the caller
+        if (condition.nodeType() != Ark::internal::NodeType::List || condition.const_list().size() != 3)
+            return false;
+
+        auto op = operatorInstruction(condition.const_list()[0]);
+        if (!op || op.value() < Instruction::GT || op.value() > Instruction::EQ)
+            return false;
+
+        for (std::size_t i=1; i < 3; ++i)
+        {
+            if (condition.const_list()[i].nodeType() == Ark::internal::NodeType::GetField ||
+                condition.const_list()[i].nodeType() == Ark::internal::NodeType::Capture)
+                return false;
+        }
+
+        _compile(condition.const_list()[1], p);
+        _compile(condition.const_list()[2], p);
+
+        page(p).emplace_back(static_cast<uint8_t>(Instruction::GT_JUMP_IF_FALSE + (op.value() - Instruction::GT)));
+        pushNumber(static_cast<uint16_t>(0x00), &page(p));
+
+        return true;
+    }
+
+    std::optional<uint8_t> Compiler::operatorInstruction(const Ark::internal::Node& x)
+    {
+        if (x.nodeType() != Ark::internal::NodeType::Symbol)
+            return {};
+
+        if (auto it_operator = isOperator(x.string()))
+            return static_cast<uint8_t>(Instruction::FIRST_OPERATOR + it_operator.value());
+        return {};
+    }
+
+    uint16_t Compiler::maxStackDepth(std::size_t page_id)
+    {
+        const std::vector<Inst>& code = m_code_pages[page_id];
+        auto argument = [&code](std::size_t i) -> long {
+            return (static_cast<long>(code[i].inst) << 8) + code[i + 1].inst;
+        };
+
+        // follow every path once, starting with the arguments on the stack. The values left on the
+        // stack by each iteration of a loop aren't counted, thus the result is only a hint for the VM
+        std::vector<bool> visited(code.size(), false);
+        std::vector<std::pair<std::size_t, long>> to_visit = { { 0, m_arities[page_id] } };
+        long max_depth = m_arities[page_id];
+
+        while (!to_visit.empty())
+        {
+            auto [i, depth] = to_visit.back();
+            to_visit.pop_back();
+
+            while (i < code.size() && !visited[i])
+            {
+                visited[i] = true;
+                uint8_t inst = code[i].inst;
+                std::size_t next = i + 3;
+
+                switch (inst)
+                {
+                    case Instruction::LOAD_SYMBOL:
+                    case Instruction::LOAD_CONST:
+                    case Instruction::BUILTIN:
+                    case Instruction::LOAD_LOCAL:
+                        depth++;
+                        break;
+
+                    case Instruction::STORE:
+                    case Instruction::LET:
+                    case Instruction::MUT:
+                    case Instruction::STORE_LOCAL:
+                    case Instruction::LET_LOCAL:
+                    case Instruction::MUT_LOCAL:
+                        depth--;
+                        break;
+
+                    case Instruction::POP_JUMP_IF_TRUE:
+                    case Instruction::POP_JUMP_IF_FALSE:
+                        depth--;
+                        to_visit.emplace_back(argument(i + 1), depth);
+                        break;
+
+                    case Instruction::GT_JUMP_IF_FALSE:
+                    case Instruction::LT_JUMP_IF_FALSE:
+                    case Instruction::LE_JUMP_IF_FALSE:
+                    case Instruction::GE_JUMP_IF_FALSE:
+                    case Instruction::NEQ_JUMP_IF_FALSE:
+                    case Instruction::EQ_JUMP_IF_FALSE:
+                        depth -= 2;
+                        to_visit.emplace_back(argument(i + 1), depth);
+                        break;
+
+                    case Instruction::JUMP:
+                        next = argument(i + 1);
+                        break;
+
+                    case Instruction::RET:
+                    case Instruction::HALT:
+                        next = code.size();
+                        break;
+
+                    // the function and its arguments are replaced by the returned value
+                    case Instruction::CALL:
+                    case Instruction::TAIL_CALL:
+                        depth -= argument(i + 1);
+                        break;
+
+                    case Instruction::CALL_BUILTIN:
+                        depth += 1 - argument(i + 3);
+                        next = i + 5;
+                        break;
+
+                    case Instruction::GET_FIELD:
+                    case Instruction::INCREMENT:
+                    case Instruction::DECREMENT:
+                    case Instruction::INCREMENT_LOCAL:
+                    case Instruction::DECREMENT_LOCAL:
+                        next = i + 5;
+                        break;
+
+                    // the constant is pushed when the value on the stack isn't a number
+                    case Instruction::ADD_CONST:
+                    case Instruction::SUB_CONST:
+                        max_depth = std::max(max_depth, depth + 1);
+                        break;
+
+                    case Instruction::SAVE_ENV:
+                    case Instruction::ASSERT:
+                    case Instruction::AT:
+                    case Instruction::AND_:
+                    case Instruction::OR_:
+                    case Instruction::MOD:
+                    case Instruction::HASFIELD:
+                        next = i + 1;
+                        if (inst == Instruction::ASSERT)
+                            depth -= 2;
+                        else if (inst != Instruction::SAVE_ENV)
+                            depth--;
+                        break;
+
+                    default:
+                        // binary operators, then the unary ones, which leave their result in place
+                        if (inst >= Instruction::FIRST_OPERATOR && inst <= Instruction::LAST_OPERATOR)
+                        {
+                            next = i + 1;
+                            if (inst <= Instruction::EQ)
+                                depth--;
+                        }
+                        // CAPTURE and DEL don't change the number of values on the stack
+                        break;
+                }
+
+                depth = std::max(depth, 0l);
+                max_depth = std::max(max_depth, depth);
+                i = next;
+            }
+        }
+
+        return static_cast<uint16_t>(std::min(max_depth, 0xffffl));
+    }
+
     std::size_t Compiler::addSymbol(const std::string& sym)
     {
         // otherwise, add the symbol, and return its id in the table
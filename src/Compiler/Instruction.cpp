@@ -9,4 +9,75 @@ namespace Ark::internal
     Inst::Inst(uint8_t inst) :
         inst(inst)
     {}
+
+    const char* instructionName(uint8_t inst)
+    {
+        switch (inst)
+        {
+            case Instruction::NOP: return "NOP";
+            case Instruction::LOAD_SYMBOL: return "LOAD_SYMBOL";
+            case Instruction::LOAD_CONST: return "LOAD_CONST";
+            case Instruction::POP_JUMP_IF_TRUE: return "POP_JUMP_IF_TRUE";
+            case Instruction::STORE: return "STORE";
+            case Instruction::LET: return "LET";
+            case Instruction::POP_JUMP_IF_FALSE: return "POP_JUMP_IF_FALSE";
+            case Instruction::JUMP: return "JUMP";
+            case Instruction::RET: return "RET";
+            case Instruction::HALT: return "HALT";
+            case Instruction::CALL: return "CALL";
+            case Instruction::CAPTURE: return "CAPTURE";
+            case Instruction::BUILTIN: return "BUILTIN";
+            case Instruction::MUT: return "MUT";
+            case Instruction::DEL: return "DEL";
+            case Instruction::SAVE_ENV: return "SAVE_ENV";
+            case Instruction::GET_FIELD: return "GET_FIELD";
+            case Instruction::LOAD_LOCAL: return "LOAD_LOCAL";
+            case Instruction::STORE_LOCAL: return "STORE_LOCAL";
+            case Instruction::LET_LOCAL: return "LET_LOCAL";
+            case Instruction::MUT_LOCAL: return "MUT_LOCAL";
+            case Instruction::TAIL_CALL: return "TAIL_CALL";
+            case Instruction::ADD: return "ADD";
+            case Instruction::SUB: return "SUB";
+            case Instruction::MUL: return "MUL";
+            case Instruction::DIV: return "DIV";
+            case Instruction::GT: return "GT";
+            case Instruction::LT: return "LT";
+            case Instruction::LE: return "LE";
+            case Instruction::GE: return "GE";
+            case Instruction::NEQ: return "NEQ";
+            case Instruction::EQ: return "EQ";
+            case Instruction::LEN: return "LEN";
+            case Instruction::EMPTY: return "EMPTY";
+            case Instruction::FIRSTOF: return "FIRSTOF";
+            case Instruction::TAILOF: return "TAILOF";
+            case Instruction::HEADOF: return "HEADOF";
+            case Instruction::ISNIL: return "ISNIL";
+            case Instruction::ASSERT: return "ASSERT";
+            case Instruction::TO_NUM: return "TO_NUM";
+            case Instruction::TO_STR: return "TO_STR";
+            case Instruction::AT: return "AT";
+            case Instruction::AND_: return "AND_";
+            case Instruction::OR_: return "OR_";
+            case Instruction::MOD: return "MOD";
+            case Instruction::TYPE: return "TYPE";
+            case Instruction::HASFIELD: return "HASFIELD";
+            case Instruction::NOT: return "NOT";
+            case Instruction::YIELD: return "YIELD";
+            case Instruction::RESUME: return "RESUME";
+            case Instruction::INCREMENT: return "INCREMENT";
+            case Instruction::DECREMENT: return "DECREMENT";
+            case Instruction::INCREMENT_LOCAL: return "INCREMENT_LOCAL";
+            case Instruction::DECREMENT_LOCAL: return "DECREMENT_LOCAL";
+            case Instruction::ADD_CONST: return "ADD_CONST";
+            case Instruction::SUB_CONST: return "SUB_CONST";
+            case Instruction::GT_JUMP_IF_FALSE: return "GT_JUMP_IF_FALSE";
+            case Instruction::LT_JUMP_IF_FALSE: return "LT_JUMP_IF_FALSE";
+            case Instruction::LE_JUMP_IF_FALSE: return "LE_JUMP_IF_FALSE";
+            case Instruction::GE_JUMP_IF_FALSE: return "GE_JUMP_IF_FALSE";
+            case Instruction::NEQ_JUMP_IF_FALSE: return "NEQ_JUMP_IF_FALSE";
+            case Instruction::EQ_JUMP_IF_FALSE: return "EQ_JUMP_IF_FALSE";
+            case Instruction::CALL_BUILTIN: return "CALL_BUILTIN";
+            default: return "UNKNOWN";
+        }
+    }
 }
\ No newline at end of file
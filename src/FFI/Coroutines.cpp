@@ -0,0 +1,32 @@
+#include <Ark/FFI/FFI.hpp>
+
+#include <Ark/VM/Coroutine.hpp>
+
+#include <Ark/FFI/FFIErrors.inl>
+#define FFI_Function(name) Value name(ArgsView n, [[maybe_unused]] ExecutionContext& context)
+
+namespace Ark::internal::FFI::Coroutines
+{
+    FFI_Function(coroutine)
+    {
+        if (n.size() < 1)
+            throw std::runtime_error(CORO_CREATE_ARITY);
+        if (!n[0].isFunction())
+            throw Ark::TypeError(CORO_CREATE_TE0);
+
+        // the function is only called when the coroutine is resumed
+        std::vector<Value> args(n.begin() + 1, n.end());
+        const void* owner = (context.vmf != nullptr) ? static_cast<const void*>(context.vmf) : static_cast<const void*>(context.vmt);
+        return Value(Coroutine(n[0], std::move(args), owner));
+    }
+
+    FFI_Function(done)
+    {
+        if (n.size() != 1)
+            throw std::runtime_error(CORO_DONE_ARITY);
+        if (n[0].valueType() != ValueType::Coroutine)
+            throw Ark::TypeError(CORO_DONE_TE0);
+
+        return (n[0].coroutine().status() == Coroutine::Status::Done) ? trueSym : falseSym;
+    }
+}
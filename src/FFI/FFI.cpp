@@ -4,7 +4,7 @@
 
 #include <Ark/FFI/FFI.hpp>
 
-#define FFI_Function(name) Value name(std::vector<Value>& n)
+#define FFI_Function(name) Value name(ArgsView n, [[maybe_unused]] ExecutionContext& context)
 
 namespace Ark::internal::FFI
 {
@@ -40,6 +40,8 @@ namespace Ark::internal::FFI
         { "sort", Value(List::sort_) },
         { "fill", Value(List::fill) },
         { "setListAt", Value(List::setListAt) },
+        { "parallelMap", Value(List::parallelMap) },
+        { "parallelForEach", Value(List::parallelForEach) },
 
         // IO
         { "print",  Value(IO::print) },
@@ -83,7 +85,11 @@ namespace Ark::internal::FFI
         { "tan", Value(Mathematics::tan_) },
         { "arccos", Value(Mathematics::acos_) },
         { "arcsin", Value(Mathematics::asin_) },
-        { "arctan", Value(Mathematics::atan_) }
+        { "arctan", Value(Mathematics::atan_) },
+
+        // Coroutines
+        { "coroutine", Value(Coroutines::coroutine) },
+        { "done?", Value(Coroutines::done) }
     };
 
     // This list is related to include/Ark/Compiler/Instructions.hpp
@@ -97,6 +103,7 @@ namespace Ark::internal::FFI
         "toNumber", "toString",
         "@", "and", "or", "mod",
         "type", "hasField",
-        "not"
+        "not",
+        "yield", "resume"
     };
 }
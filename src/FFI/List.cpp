@@ -1,10 +1,11 @@
 #include <Ark/FFI/FFI.hpp>
+#include <Ark/VM/VM.hpp>
 
 #include <iterator>
 #include <algorithm>
 
 #include <Ark/FFI/FFIErrors.inl>
-#define FFI_Function(name) Value name(std::vector<Value>& n)
+#define FFI_Function(name) Value name(ArgsView n, [[maybe_unused]] ExecutionContext& context)
 
 namespace Ark::internal::FFI::List
 {
@@ -15,7 +16,7 @@ namespace Ark::internal::FFI::List
         if (n[0].valueType() != ValueType::List)
             throw Ark::TypeError(LIST_APPEND_TE0);
 
-        for (Value::Iterator it=n.begin()+1; it != n.end(); ++it)
+        for (auto it=n.begin()+1; it != n.end(); ++it)
             n[0].push_back(*it);
         return n[0];
     }
@@ -25,7 +26,7 @@ namespace Ark::internal::FFI::List
         if (n[0].valueType() != ValueType::List)
             throw Ark::TypeError(LIST_CONCAT_ARITY);
 
-        for (Value::Iterator it=n.begin()+1; it != n.end(); ++it)
+        for (auto it=n.begin()+1; it != n.end(); ++it)
         {
             if (it->valueType() != ValueType::List)
                 throw Ark::TypeError(LIST_CONCAT_TE);
@@ -39,7 +40,7 @@ namespace Ark::internal::FFI::List
     FFI_Function(list)
     {
         Value r(ValueType::List);
-        for (Value::Iterator it=n.begin(); it != n.end(); ++it)
+        for (auto it=n.begin(); it != n.end(); ++it)
             r.push_back(*it);
         return r;
     }
@@ -63,7 +64,7 @@ namespace Ark::internal::FFI::List
         if (n[0].valueType() != ValueType::List)
             throw Ark::TypeError(LIST_FIND_TE0);
         
-        std::vector<Value>& l = n[0].list();
+        const std::vector<Value>& l = n[0].const_list();
         for (Value::Iterator it=l.begin(); it != l.end(); ++it)
         {
             if (*it == n[1])
@@ -83,7 +84,7 @@ namespace Ark::internal::FFI::List
             throw Ark::TypeError(LIST_RMAT_TE1);
 
         std::size_t idx = static_cast<std::size_t>(n[1].number());
-        if (idx < 0 || idx >= n[0].list().size())
+        if (idx < 0 || idx >= n[0].const_list().size())
             throw std::runtime_error(LIST_RMAT_OOR);
 
         n[0].list().erase(n[0].list().begin () + idx);
@@ -112,12 +113,12 @@ namespace Ark::internal::FFI::List
 
         if (start > end)
             throw std::runtime_error(LIST_SLICE_ORDER);
-        if (start < 0 || end > n[0].list().size())
+        if (start < 0 || end > n[0].const_list().size())
             throw std::runtime_error(LIST_SLICE_OOR);
 
         std::vector<Value> retlist;
         for (std::size_t i=start; i < end; i += step)
-            retlist.push_back(n[0].list()[i]);
+            retlist.push_back(n[0].const_list()[i]);
 
         Value ret(std::move(retlist));
         return ret;
@@ -161,4 +162,37 @@ namespace Ark::internal::FFI::List
         n[0].list()[static_cast<std::size_t>(n[1].number())] = n[2];
         return n[0];
     }
+
+    // the calls are made by the workers of the VM running the builtin
+    std::vector<Value> parallelCall(const Value& function, const std::vector<Value>& list, ExecutionContext& context)
+    {
+        if (context.vmf != nullptr)
+            return context.vmf->parallelCall(function, list);
+        return context.vmt->parallelCall(function, list);
+    }
+
+    FFI_Function(parallelMap)
+    {
+        if (n.size() != 2)
+            throw std::runtime_error(LIST_PMAP_ARITY);
+        if (!n[0].isFunction())
+            throw Ark::TypeError(LIST_PMAP_TE0);
+        if (n[1].valueType() != ValueType::List)
+            throw Ark::TypeError(LIST_PMAP_TE1);
+
+        return Value(parallelCall(n[0], n[1].const_list(), context));
+    }
+
+    FFI_Function(parallelForEach)
+    {
+        if (n.size() != 2)
+            throw std::runtime_error(LIST_PFOREACH_ARITY);
+        if (n[0].valueType() != ValueType::List)
+            throw Ark::TypeError(LIST_PFOREACH_TE0);
+        if (!n[1].isFunction())
+            throw Ark::TypeError(LIST_PFOREACH_TE1);
+
+        parallelCall(n[1], n[0].const_list(), context);
+        return FFI::nil;
+    }
 }
@@ -4,7 +4,7 @@
 #include <Ark/FFI/FFI.hpp>
 
 #include <Ark/FFI/FFIErrors.inl>
-#define FFI_Function(name) Value name(std::vector<Value>& n)
+#define FFI_Function(name) Value name(ArgsView n, [[maybe_unused]] ExecutionContext& context)
 
 namespace Ark::internal::FFI::Mathematics
 {
@@ -3,7 +3,7 @@
 #include <fmt/format.hpp>
 
 #include <Ark/FFI/FFIErrors.inl>
-#define FFI_Function(name) Value name(std::vector<Value>& n)
+#define FFI_Function(name) Value name(ArgsView n, [[maybe_unused]] ExecutionContext& context)
 
 namespace Ark::internal::FFI::String
 {
@@ -16,7 +16,7 @@ namespace Ark::internal::FFI::String
 
         rj::format f(n[0].string());
 
-        for (Value::Iterator it=n.begin()+1; it != n.end(); ++it)
+        for (auto it=n.begin()+1; it != n.end(); ++it)
         {
             if (it->valueType() == ValueType::String)
                 f.args(it->string());
@@ -107,6 +107,16 @@ namespace Ark::internal
         return m_col;
     }
 
+    void Node::setFilename(const std::string& filename)
+    {
+        m_filename = filename;
+    }
+
+    const std::string& Node::filename() const
+    {
+        return m_filename;
+    }
+
     // -------------------------
 
     auto colors = std::vector({
@@ -42,6 +42,8 @@ namespace Ark
         except(!tokens.empty(), "Invalid syntax: no more token to consume", Token(TokenType::Mismatch, "", 0, 0));
         m_last_token = tokens.front();
         m_ast = parse(tokens);
+        // used by the compiler for the debug information
+        m_ast.setFilename(m_file);
         // include files if needed
         checkForInclude(m_ast);
 
@@ -0,0 +1,13 @@
+#include <Ark/VM/Callback.hpp>
+
+namespace Ark::internal
+{
+    Callback::Callback(const Value& function) :
+        m_function(function)
+    {
+        if (function.valueType() != ValueType::PageAddr &&
+            function.valueType() != ValueType::Closure &&
+            function.valueType() != ValueType::CProc)
+            throw Ark::TypeError("Callback needs a function");
+    }
+}
@@ -0,0 +1,33 @@
+#include <Ark/VM/Coroutine.hpp>
+
+#include <Ark/VM/Scope.hpp>
+
+namespace Ark::internal
+{
+    Coroutine::Coroutine() :
+        m_status(Status::Done), m_owner(nullptr),
+        m_ip(0), m_pp(0), m_caller_scopes(0),
+        m_frames_base(0), m_locals_base(0), m_caller_scope_count(0)
+    {}
+
+    Coroutine::Coroutine(const Value& function, std::vector<Value>&& args, const void* owner) :
+        m_status(Status::Created), m_owner(owner),
+        m_function(function), m_args(std::move(args)),
+        m_ip(0), m_pp(0), m_caller_scopes(0),
+        m_frames_base(0), m_locals_base(0), m_caller_scope_count(0)
+    {}
+
+    std::ostream& operator<<(std::ostream& os, const Coroutine& C)
+    {
+        os << "Coroutine<";
+        switch (C.m_status)
+        {
+            case Coroutine::Status::Created:   os << "created"; break;
+            case Coroutine::Status::Suspended: os << "suspended"; break;
+            case Coroutine::Status::Running:   os << "running"; break;
+            case Coroutine::Status::Done:      os << "done"; break;
+        }
+        os << ">";
+        return os;
+    }
+}
@@ -4,14 +4,14 @@ namespace Ark::internal
 {
     Frame::Frame() :
         m_addr(0), m_page_addr(0), m_new_pp(0),
-        m_stack(ARK_MAX_STACK_SIZE), m_i(0),
-        m_scope_to_delete(0)
+        m_base(0),
+        m_scope_to_delete(0), m_hidden_scope(false)
     {}
 
-    Frame::Frame(std::size_t caller_addr, std::size_t caller_page_addr, std::size_t new_pp) :
+    Frame::Frame(std::size_t caller_addr, std::size_t caller_page_addr, std::size_t new_pp, std::size_t stack_base) :
         m_addr(caller_addr), m_page_addr(caller_page_addr), m_new_pp(new_pp),
-        m_stack(ARK_MAX_STACK_SIZE), m_i(0),
-        m_scope_to_delete(0)
+        m_base(stack_base),
+        m_scope_to_delete(0), m_hidden_scope(false)
     {}
 
     std::ostream& operator<<(std::ostream& os, const Frame& F)
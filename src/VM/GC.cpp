@@ -0,0 +1,175 @@
+#include <Ark/VM/GC.hpp>
+
+#include <chrono>
+#include <algorithm>
+#include <unordered_map>
+
+namespace Ark::internal
+{
+    GC::GC(std::size_t threshold) :
+        m_initial_threshold(threshold)
+    {
+        m_stats.threshold = threshold;
+    }
+
+    GC::~GC()
+    {
+        if (!m_nursery.empty() || !m_tracked.empty())
+            collect();
+    }
+
+    void GC::minorCollection()
+    {
+        m_stats.minor_collections++;
+        promote();
+
+        if (m_tracked.size() >= m_stats.threshold)
+            collect();
+    }
+
+    void GC::collect()
+    {
+        auto start = std::chrono::steady_clock::now();
+        promote();
+
+        struct Node
+        {
+            std::size_t refs;           // reference count of the object
+            std::size_t internal = 0;   // references coming from the objects seen by the collector
+            Kind kind;
+            bool marked = false;
+        };
+        std::unordered_map<void*, Node> nodes;
+        std::vector<void*> to_visit;
+
+        // count the references between the tracked scopes and everything reachable from them
+        for (const std::weak_ptr<Scope>& scope : m_tracked)
+        {
+            void* ptr = scope.lock().get();
+            if (ptr == nullptr)
+                continue;
+            if (nodes.try_emplace(ptr, Node { static_cast<std::size_t>(scope.use_count()), 0, Kind::Scope }).second)
+                to_visit.push_back(ptr);
+        }
+        while (!to_visit.empty())
+        {
+            void* ptr = to_visit.back();
+            to_visit.pop_back();
+
+            forEachReference(ptr, nodes.at(ptr).kind, [&nodes, &to_visit](void* child, Kind kind, std::size_t refs) {
+                auto [it, inserted] = nodes.try_emplace(child, Node { refs, 0, kind });
+                it->second.internal++;
+                if (inserted)
+                    to_visit.push_back(child);
+            });
+        }
+
+        // objects with more references than the ones we found are used from outside, thus alive,
+        // as is everything they reference
+        for (auto& [ptr, node] : nodes)
+        {
+            if (node.refs > node.internal)
+            {
+                node.marked = true;
+                to_visit.push_back(ptr);
+            }
+        }
+        while (!to_visit.empty())
+        {
+            void* ptr = to_visit.back();
+            to_visit.pop_back();
+
+            forEachReference(ptr, nodes.at(ptr).kind, [&nodes, &to_visit](void* child, Kind, std::size_t) {
+                Node& node = nodes.at(child);
+                if (!node.marked)
+                {
+                    node.marked = true;
+                    to_visit.push_back(child);
+                }
+            });
+        }
+
+        // the other ones are only referenced by cycles: empty their scopes, the values are
+        // destroyed once every cycle is broken
+        std::vector<std::vector<std::pair<uint16_t, Value>>> garbage;
+        for (auto& [ptr, node] : nodes)
+        {
+            if (!node.marked && node.kind == Kind::Scope)
+            {
+                Scope* scope = static_cast<Scope*>(ptr);
+                garbage.push_back(std::move(scope->m_data));
+                scope->m_data.clear();
+            }
+        }
+        m_stats.freed_scopes += garbage.size();
+        garbage.clear();
+
+        m_tracked.erase(
+            std::remove_if(m_tracked.begin(), m_tracked.end(), [](const std::weak_ptr<Scope>& scope) {
+                return scope.expired();
+            }),
+            m_tracked.end()
+        );
+
+        m_stats.collections++;
+        m_stats.tracked_scopes = m_tracked.size();
+        m_stats.threshold = std::max(m_initial_threshold, 2 * m_tracked.size());
+        m_stats.time_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void GC::setThreshold(std::size_t threshold)
+    {
+        m_initial_threshold = threshold;
+        m_stats.threshold = threshold;
+    }
+
+    const GC::Stats& GC::stats() const
+    {
+        return m_stats;
+    }
+
+    void GC::promote()
+    {
+        for (std::weak_ptr<Scope>& scope : m_nursery)
+        {
+            if (!scope.expired())
+                m_tracked.push_back(std::move(scope));
+        }
+        m_nursery.clear();
+    }
+
+    template <typename F>
+    void GC::forEachReference(void* object, Kind kind, F&& visit)
+    {
+        switch (kind)
+        {
+            case Kind::Scope:
+                for (const auto& pair : static_cast<Scope*>(object)->m_data)
+                    visitValue(pair.second, visit);
+                break;
+
+            case Kind::List:
+                for (const Value& value : static_cast<Value::Cell_t<std::vector<Value>>*>(object)->data)
+                    visitValue(value, visit);
+                break;
+
+            case Kind::Closure:
+            {
+                const Scope_t& scope = static_cast<Value::Cell_t<Closure>*>(object)->data.scope();
+                if (scope)
+                    visit(scope.get(), Kind::Scope, static_cast<std::size_t>(scope.use_count()));
+                break;
+            }
+        }
+    }
+
+    template <typename F>
+    void GC::visitValue(const Value& value, F&& visit)
+    {
+        // strings, procedures and user types can not reference a scope
+        if (value.m_type == ValueType::List)
+            visit(value.m_cell, Kind::List, value.m_cell->refcount.load());
+        else if (value.m_type == ValueType::Closure)
+            visit(value.m_cell, Kind::Closure, value.m_cell->refcount.load());
+    }
+}
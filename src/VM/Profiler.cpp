@@ -0,0 +1,115 @@
+#include <Ark/VM/Profiler.hpp>
+
+#include <algorithm>
+#include <iomanip>
+
+#include <Ark/Compiler/Instructions.hpp>
+
+namespace Ark::internal
+{
+    Profiler::Profiler(std::size_t pages_count) :
+        m_pages(pages_count), m_active(pages_count, 0)
+    {}
+
+    void Profiler::resize(std::size_t pages_count)
+    {
+        if (pages_count > m_pages.size())
+        {
+            m_pages.resize(pages_count);
+            m_active.resize(pages_count, 0);
+        }
+    }
+
+    void Profiler::enter(PageAddr_t page)
+    {
+        m_pages[page].calls++;
+        m_active[page]++;
+        m_stack.push_back(Entry { page, Clock::now() });
+    }
+
+    void Profiler::leave()
+    {
+        Entry entry = m_stack.back();
+        m_stack.pop_back();
+
+        Clock::duration elapsed = Clock::now() - entry.start;
+        PageStats& stats = m_pages[entry.page];
+        stats.exclusive += elapsed - entry.children;
+        // the outermost call of a recursive function already includes the other ones
+        if (--m_active[entry.page] == 0)
+            stats.inclusive += elapsed;
+
+        if (!m_stack.empty())
+            m_stack.back().children += elapsed;
+    }
+
+    void Profiler::leaveAll()
+    {
+        while (!m_stack.empty())
+            leave();
+    }
+
+    void Profiler::report(std::ostream& os, const std::vector<std::string>& page_names) const
+    {
+        auto ms = [](Clock::duration d) {
+            return std::chrono::duration<double, std::milli>(d).count();
+        };
+        auto name = [&page_names](std::size_t page) -> std::string {
+            if (page < page_names.size())
+                return page_names[page];
+            return "page " + std::to_string(page);
+        };
+
+        std::ios_base::fmtflags flags = os.flags();
+        std::streamsize precision = os.precision();
+        os << std::fixed << std::setprecision(3);
+
+        std::vector<std::size_t> pages;
+        for (std::size_t i=0; i < m_pages.size(); ++i)
+        {
+            if (m_pages[i].calls != 0 || m_pages[i].instructions != 0)
+                pages.push_back(i);
+        }
+        std::sort(pages.begin(), pages.end(), [this](std::size_t a, std::size_t b) {
+            return m_pages[a].exclusive > m_pages[b].exclusive;
+        });
+
+        os << "\nFunctions:\n";
+        os << std::setw(12) << "calls" << std::setw(16) << "instructions" << std::setw(16) << "inclusive (ms)"
+           << std::setw(16) << "exclusive (ms)" << "  name\n";
+        for (std::size_t page : pages)
+        {
+            const PageStats& stats = m_pages[page];
+            os << std::setw(12) << stats.calls << std::setw(16) << stats.instructions << std::setw(16) << ms(stats.inclusive)
+               << std::setw(16) << ms(stats.exclusive) << "  " << name(page) << "\n";
+        }
+
+        std::vector<std::pair<uint8_t, std::size_t>> opcodes;
+        std::size_t total = 0;
+        for (std::size_t i=0; i < m_opcodes.size(); ++i)
+        {
+            if (m_opcodes[i] != 0)
+                opcodes.emplace_back(static_cast<uint8_t>(i), m_opcodes[i]);
+            total += m_opcodes[i];
+        }
+        std::sort(opcodes.begin(), opcodes.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+        os << "\nInstructions (" << total << " executed):\n";
+        for (auto&& [inst, count] : opcodes)
+            os << std::setw(12) << count << std::setw(8) << std::setprecision(2) << (100.0 * count / total) << "%  " << instructionName(inst) << "\n";
+        os << std::setprecision(3);
+
+        std::vector<std::pair<uint64_t, std::size_t>> sites(m_call_sites.begin(), m_call_sites.end());
+        std::sort(sites.begin(), sites.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+        if (sites.size() > 20)
+            sites.resize(20);
+
+        os << "\nMost used call sites:\n";
+        for (auto&& [site, count] : sites)
+            os << std::setw(12) << count << "  " << name(site >> 32) << ", instruction " << (site & 0xffffffff) << "\n";
+        os << std::endl;
+
+        os.flags(flags);
+        os.precision(precision);
+    }
+}
@@ -0,0 +1,56 @@
+#include <Ark/VM/Sampler.hpp>
+
+namespace Ark::internal
+{
+    Sampler::Sampler(std::function<void()> request, std::chrono::microseconds interval) :
+        m_samples(0), m_stop(false)
+    {
+        m_thread = std::thread([this, request, interval] {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            // wake up at each interval until we are asked to stop
+            while (!m_stop_requested.wait_for(lock, interval, [this] { return m_stop; }))
+                request();
+        });
+    }
+
+    Sampler::~Sampler()
+    {
+        stop();
+    }
+
+    void Sampler::stop()
+    {
+        if (!m_thread.joinable())
+            return;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_stop_requested.notify_one();
+        m_thread.join();
+    }
+
+    void Sampler::record(const std::vector<PageAddr_t>& stack)
+    {
+        m_stacks[stack]++;
+        m_samples++;
+    }
+
+    void Sampler::write(std::ostream& os, const std::vector<std::string>& page_names) const
+    {
+        for (auto&& [stack, count] : m_stacks)
+        {
+            for (std::size_t i=0; i < stack.size(); ++i)
+            {
+                if (i > 0)
+                    os << ";";
+                if (stack[i] < page_names.size())
+                    os << page_names[stack[i]];
+                else
+                    os << "page " << stack[i];
+            }
+            os << " " << count << "\n";
+        }
+    }
+}
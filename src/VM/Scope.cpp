@@ -0,0 +1,163 @@
+#include <Ark/VM/Scope.hpp>
+
+#include <algorithm>
+#include <iterator>
+
+#include <Ark/FFI/FFI.hpp>
+
+namespace Ark::internal
+{
+    Scope::Scope() :
+        m_owner(0)
+    {}
+
+    Scope::Scope(const std::vector<uint16_t>& symbols) :
+        m_owner(0)
+    {
+        // keep room for the function itself, stored in its scope when called
+        m_data.reserve(symbols.size() + 1);
+        for (uint16_t id : symbols)
+            m_data.emplace_back(id, FFI::undefined);
+    }
+
+    Scope::Scope(std::size_t symbols_count) :
+        m_owner(0)
+    {
+        reset(symbols_count);
+    }
+
+    Value& Scope::set(uint16_t id, const Value& value)
+    {
+        if (Value* var = find(id))
+            return *var = value;
+        return m_data.emplace_back(id, value).second;
+    }
+
+    Value& Scope::set(uint16_t id, Value&& value)
+    {
+        if (Value* var = find(id))
+            return *var = std::move(value);
+        return m_data.emplace_back(id, std::move(value)).second;
+    }
+
+    void Scope::reset(std::size_t symbols_count)
+    {
+        m_data.clear();
+        m_owner = 0;
+        m_data.reserve(symbols_count);
+        for (std::size_t id=0; id < symbols_count; ++id)
+            m_data.emplace_back(static_cast<uint16_t>(id), FFI::undefined);
+    }
+
+    void Scope::reset(const std::vector<uint16_t>& symbols)
+    {
+        m_data.clear();
+        m_owner = 0;
+        m_data.reserve(symbols.size() + 1);
+        for (uint16_t id : symbols)
+            m_data.emplace_back(id, FFI::undefined);
+    }
+
+    void Scope::reserve(std::size_t count)
+    {
+        m_data.reserve(count);
+    }
+
+    void Scope::resize(std::size_t symbols_count)
+    {
+        m_data.reserve(symbols_count);
+        for (std::size_t id=0; id < symbols_count; ++id)
+        {
+            if (find(static_cast<uint16_t>(id)) == nullptr)
+                m_data.emplace_back(static_cast<uint16_t>(id), FFI::undefined);
+        }
+    }
+
+    void Scope::inherit(const Scope& scope, Scope* hidden)
+    {
+        for (auto& [id, value] : scope.m_data)
+        {
+            if (value == FFI::undefined)
+                continue;
+
+            if (find(id) != nullptr)
+            {
+                if (hidden != nullptr)
+                    hidden->set(id, value);
+            }
+            else
+                m_data.emplace_back(id, value);
+        }
+    }
+
+    void Scope::reuse(const std::vector<uint16_t>& symbols, Scope* hidden)
+    {
+        // the first slots are often for the same symbols, always when a function calls itself
+        std::size_t same = 0;
+        while (same < symbols.size() && same < m_data.size() && m_data[same].first == symbols[same])
+            same++;
+
+        for (std::size_t i=0; i < same; ++i)
+        {
+            Value& value = m_data[i].second;
+            if (hidden != nullptr && value != FFI::undefined)
+                hidden->set(m_data[i].first, std::move(value));
+            value = FFI::undefined;
+        }
+        // the other variables can't be one of the symbols, the ids being unique
+        if (same == symbols.size())
+            return;
+
+        std::vector<std::pair<uint16_t, Value>> others(
+            std::make_move_iterator(m_data.begin() + same), std::make_move_iterator(m_data.end())
+        );
+        m_data.erase(m_data.begin() + same, m_data.end());
+        for (std::size_t i=same; i < symbols.size(); ++i)
+            m_data.emplace_back(symbols[i], FFI::undefined);
+
+        for (auto& [id, value] : others)
+        {
+            if (value == FFI::undefined)
+                continue;
+
+            if (std::find(symbols.begin() + same, symbols.end(), id) != symbols.end())
+            {
+                if (hidden != nullptr)
+                    hidden->set(id, std::move(value));
+            }
+            else
+                m_data.emplace_back(id, std::move(value));
+        }
+    }
+
+    bool Scope::defines(const std::vector<uint16_t>& symbols) const
+    {
+        for (std::size_t i=0; i < symbols.size(); ++i)
+        {
+            // slot i is checked first, it often holds the symbol i
+            if (i < m_data.size() && m_data[i].first == symbols[i])
+            {
+                if (m_data[i].second != FFI::undefined)
+                    return true;
+                continue;
+            }
+
+            for (auto& [id, value] : m_data)
+            {
+                if (id == symbols[i] && value != FFI::undefined)
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    std::vector<std::pair<uint16_t, Value>>::const_iterator Scope::begin() const
+    {
+        return m_data.begin();
+    }
+
+    std::vector<std::pair<uint16_t, Value>>::const_iterator Scope::end() const
+    {
+        return m_data.end();
+    }
+}
\ No newline at end of file
@@ -1,16 +1,20 @@
 #include <Ark/VM/State.hpp>
 
+#include <algorithm>
+
 #include <Ark/Constants.hpp>
 
 namespace Ark
 {
     State::State(const std::string& libdir, uint16_t options) :
         m_libdir(libdir == "" ? ARK_STD_DEFAULT : libdir), m_filename("FILE"),
-        m_options(options), m_debug_level(0)
+        m_options(options), m_debug_level(0), m_debug_start(0), m_frozen(false)
     {}
 
     bool State::feed(const std::string& bytecode_filename)
     {
+        checkNotFrozen("feed bytecode");
+
         bool result = true;
         try
         {
@@ -32,6 +36,8 @@ namespace Ark
 
     bool State::feed(const bytecode_t& bytecode)
     {
+        checkNotFrozen("feed bytecode");
+
         bool result = true;
         try
         {
@@ -77,6 +83,8 @@ namespace Ark
 
     bool State::doFile(const std::string& file)
     {
+        checkNotFrozen("load a file");
+
         if (!Ark::Utils::fileExists(file))
         {
             Ark::logger.error("Can not find file '" + file + "'");
@@ -120,8 +128,8 @@ namespace Ark
                 // TODO fix me, timestamp is wrong on Windows (by 369 years)
                 // Ark::logger.data("doFile() timestamp bytecode file:", timestamp, " ; timestamp " + file + ":", file_last_write);
 
-                // recompile
-                if (timestamp < file_last_write)
+                // recompile, also when it was compiled by a version of ArkScript using another bytecode format
+                if (timestamp < file_last_write || bcr2.majorVersion() != ARK_VERSION_MAJOR)
                     compiled_successfuly = Ark::compile(m_debug_level, file, path, m_libdir, m_options);
                 else
                     compiled_successfuly = true;
@@ -144,6 +152,8 @@ namespace Ark
 
     bool State::doString(const std::string& code)
     {
+        checkNotFrozen("compile code");
+
         Compiler compiler(m_debug_level, m_libdir, m_options);
 
         try
@@ -169,20 +179,54 @@ namespace Ark
 
     void State::loadFunction(const std::string& name, internal::Value::ProcType function)
     {
+        checkNotFrozen("bind a function");
         m_binded_functions[name] = std::move(function);
     }
 
     void State::setDebug(unsigned level)
     {
+        checkNotFrozen("change the debug level");
         m_debug_level = level;
     }
 
+    void State::freeze()
+    {
+        using namespace Ark::internal;
+
+        if (m_frozen)
+            return;
+
+        // same order as VM::init, plugins functions replace the binded ones with the same name
+        for (auto&& [name, function] : m_binded_functions)
+        {
+            if (auto id = symbolId(name))
+                m_frozen_functions.emplace_back(id.value(), Value(function));
+        }
+
+        for (auto&& plugin : m_shared_lib_objects)
+        {
+            using Mapping_t = std::unordered_map<std::string, Value::ProcType>;
+            using map_fun_t = Mapping_t(*) ();
+            Mapping_t map = plugin.get<map_fun_t>("getFunctionsMapping")();
+
+            for (auto&& [name, function] : map)
+            {
+                if (auto id = symbolId(name))
+                    m_frozen_functions.emplace_back(id.value(), Value(function));
+            }
+        }
+
+        m_frozen = true;
+    }
+
     void State::configure()
     {
         using namespace Ark::internal;
 
         // configure tables and pages
         std::size_t i = 0;
+        m_debug_start = 0;
+        m_debug_info.reset();
 
         auto readNumber = [&, this] (std::size_t& i) -> uint16_t {
             uint16_t x = (static_cast<uint16_t>(m_bytecode[i]) << 8); ++i;
@@ -229,6 +273,7 @@ namespace Ark
             i++;
             uint16_t size = readNumber(i);
             m_symbols.reserve(size);
+            m_symbol_ids.reserve(size);
             i++;
 
             for (uint16_t j=0; j < size; ++j)
@@ -238,6 +283,8 @@ namespace Ark
                     symbol.push_back(m_bytecode[i++]);
                 i++;
 
+                // the VM finds symbols by name through this index, instead of searching the table
+                m_symbol_ids.emplace(symbol, static_cast<uint16_t>(m_symbols.size()));
                 m_symbols.push_back(symbol);
             }
         }
@@ -263,7 +310,7 @@ namespace Ark
                         val.push_back(m_bytecode[i++]);
                     i++;
 
-                    m_constants.emplace_back(std::stod(val));
+                    m_constants.push_back(integralOrDouble(std::stod(val)));
                 }
                 else if (type == Instruction::STRING_TYPE)
                 {
@@ -307,23 +354,69 @@ namespace Ark
         }
         else
             throwStateError("couldn't find plugins table");
+
+        if (m_bytecode[i] == Instruction::FUNCTIONS_TABLE_START)
+        {
+            i++;
+            uint16_t size = readNumber(i);
+            m_functions.reserve(size);
+            i++;
+
+            for (uint16_t j=0; j < size; ++j)
+            {
+                FunctionInfo info;
+                info.arity = readNumber(i); i++;
+                info.locals = readNumber(i); i++;
+                info.max_stack = readNumber(i); i++;
+
+                m_functions.push_back(info);
+            }
+        }
+        else
+            throwStateError("couldn't find functions table");
         
         while (m_bytecode[i] == Instruction::CODE_SEGMENT_START)
         {
             i++;
+            uint16_t locals_count = readNumber(i);
+            i++;
+
+            std::vector<uint16_t> locals;
+            locals.reserve(locals_count);
+            for (uint16_t j=0; j < locals_count; ++j)
+            {
+                uint16_t id = readNumber(i);
+                i++;
+
+                if (id >= m_symbols.size())
+                    throwStateError("invalid symbol id " + Ark::Utils::toString(id) + " in the locals of page " +
+                        Ark::Utils::toString(m_pages.size()));
+                locals.push_back(id);
+            }
+            if (m_pages.size() >= m_functions.size() || m_functions[m_pages.size()].locals != locals_count)
+                throwStateError("functions table doesn't match page " + Ark::Utils::toString(m_pages.size()));
+            m_page_locals.push_back(std::move(locals));
+
             uint16_t size = readNumber(i);
             i++;
 
-            m_pages.emplace_back();
-            m_pages.back().reserve(size);
+            bytecode_t page;
+            page.reserve(size);
+            m_page_starts.push_back(i);
 
             for (uint16_t j=0; j < size; ++j)
-                m_pages.back().push_back(m_bytecode[i++]);
+                page.push_back(m_bytecode[i++]);
+
+            m_pages.push_back(decodePage(page));
             
             if (i == m_bytecode.size())
                 break;
         }
 
+        // optional, only read when needed
+        if (i < m_bytecode.size() && m_bytecode[i] == Instruction::DEBUG_TABLE_START)
+            m_debug_start = i;
+
         for (const std::string& file : m_plugins)
         {
             namespace fs = std::filesystem;
@@ -341,4 +434,212 @@ namespace Ark
                 throwStateError("could not load plugin " + file);
         }
     }
+
+    std::vector<internal::Word> State::decodePage(const bytecode_t& page)
+    {
+        using namespace Ark::internal;
+
+        std::vector<Word> words;
+        words.reserve(page.size());
+        // byte offset of an instruction -> index of its word, to translate the jumps
+        std::vector<int> word_index(page.size() + 1, -1);
+
+        for (std::size_t i=0; i < page.size(); ++i)
+        {
+            uint8_t inst = page[i];
+            word_index[i] = static_cast<int>(words.size());
+            std::size_t size = instructionSize(inst);
+
+            if (size == 1)
+                words.emplace_back(inst);
+            else if (size == 5)
+            {
+                // two arguments on two bytes each, the second one goes into an extension word read
+                // by the instruction itself
+                if (i + 4 >= page.size())
+                    throwStateError("missing argument for instruction " + Ark::Utils::toString(static_cast<int>(inst)) +
+                        " in page " + Ark::Utils::toString(m_pages.size()) + " at " + Ark::Utils::toString(i));
+
+                uint16_t arg = (static_cast<uint16_t>(page[i + 1]) << 8) + static_cast<uint16_t>(page[i + 2]);
+                uint16_t ext = (static_cast<uint16_t>(page[i + 3]) << 8) + static_cast<uint16_t>(page[i + 4]);
+                words.emplace_back(inst, arg);
+                words.emplace_back(Instruction::NOP, ext);
+                i += 4;
+            }
+            else if (size == 3)
+            {
+                // argument on two bytes, big endian
+                if (i + 2 >= page.size())
+                    throwStateError("missing argument for instruction " + Ark::Utils::toString(static_cast<int>(inst)) +
+                        " in page " + Ark::Utils::toString(m_pages.size()) + " at " + Ark::Utils::toString(i));
+
+                uint16_t arg = (static_cast<uint16_t>(page[i + 1]) << 8) + static_cast<uint16_t>(page[i + 2]);
+                words.emplace_back(inst, arg);
+                i += 2;
+            }
+            else
+                // the VM dispatches instructions through a table indexed by opcode, thus
+                // we need to be sure that every opcode is known before running anything
+                throwStateError("unknown instruction " + Ark::Utils::toString(static_cast<int>(inst)) +
+                    " in page " + Ark::Utils::toString(m_pages.size()) + " at " + Ark::Utils::toString(i));
+        }
+        word_index[page.size()] = static_cast<int>(words.size());
+
+        // the VM doesn't check if it went too far, so every page must end with a HALT
+        if (words.empty() || words.back().opcode != Instruction::HALT)
+            words.emplace_back(Instruction::HALT);
+
+        // jumps are given as byte offsets in the bytecode, the VM needs instruction indices
+        for (Word& word : words)
+        {
+            if (word.opcode == Instruction::JUMP || word.opcode == Instruction::POP_JUMP_IF_TRUE ||
+                word.opcode == Instruction::POP_JUMP_IF_FALSE ||
+                (Instruction::GT_JUMP_IF_FALSE <= word.opcode && word.opcode <= Instruction::EQ_JUMP_IF_FALSE))
+            {
+                if (word.data > page.size() || word_index[word.data] == -1 ||
+                    static_cast<std::size_t>(word_index[word.data]) >= words.size())
+                    throwStateError("invalid jump address " + Ark::Utils::toString(word.data) +
+                        " in page " + Ark::Utils::toString(m_pages.size()));
+                word.data = static_cast<uint16_t>(word_index[word.data]);
+            }
+            else if ((Instruction::LOAD_LOCAL <= word.opcode && word.opcode <= Instruction::MUT_LOCAL) ||
+                word.opcode == Instruction::INCREMENT_LOCAL || word.opcode == Instruction::DECREMENT_LOCAL)
+            {
+                // the VM doesn't check the slots, they must exist in the scope of the page
+                if (word.data >= m_page_locals[m_pages.size()].size())
+                    throwStateError("invalid local slot " + Ark::Utils::toString(word.data) +
+                        " in page " + Ark::Utils::toString(m_pages.size()));
+            }
+        }
+
+        return words;
+    }
+
+    std::size_t State::instructionSize(uint8_t inst)
+    {
+        using namespace Ark::internal;
+
+        if ((Instruction::FIRST_OPERATOR <= inst && inst <= Instruction::LAST_OPERATOR) ||
+            inst == Instruction::NOP || inst == Instruction::RET ||
+            inst == Instruction::HALT || inst == Instruction::SAVE_ENV)
+            return 1;
+        else if ((Instruction::INCREMENT <= inst && inst <= Instruction::DECREMENT_LOCAL) ||
+            inst == Instruction::CALL_BUILTIN || inst == Instruction::GET_FIELD)
+            return 5;
+        else if ((Instruction::FIRST_COMMAND <= inst && inst <= Instruction::LAST_COMMAND) ||
+            (Instruction::ADD_CONST <= inst && inst <= Instruction::EQ_JUMP_IF_FALSE))
+            return 3;
+        return 0;
+    }
+
+    const State::DebugInfo* State::debugInfo() const
+    {
+        using namespace Ark::internal;
+
+        if (m_debug_start == 0)
+            return nullptr;
+
+        // VMs running on different threads can share the state
+        std::lock_guard<std::mutex> lock(m_debug_mutex);
+        if (m_debug_info)
+            return m_debug_info.get();
+
+        auto info = std::make_unique<DebugInfo>();
+        std::size_t i = m_debug_start + 1;
+
+        // the bytecode was validated up to here, but not the debug information
+        auto readNumber = [this, &i] () -> uint16_t {
+            if (i + 1 >= m_bytecode.size())
+                throw std::out_of_range("truncated debug information");
+            uint16_t x = (static_cast<uint16_t>(m_bytecode[i]) << 8) + static_cast<uint16_t>(m_bytecode[i + 1]);
+            i += 2;
+            return x;
+        };
+        auto readString = [this, &i] () -> std::string {
+            std::string str = "";
+            while (i < m_bytecode.size() && m_bytecode[i] != 0)
+                str.push_back(m_bytecode[i++]);
+            i++;
+            return str;
+        };
+
+        try
+        {
+            uint16_t files_count = readNumber();
+            for (uint16_t j=0; j < files_count; ++j)
+                info->files.push_back(readString());
+
+            uint16_t pages_count = readNumber();
+            for (uint16_t page=0; page < pages_count; ++page)
+            {
+                info->page_names.push_back(readString());
+                info->locations.emplace_back();
+
+                uint16_t count = readNumber();
+                // the compiler gives byte offsets, find the index of the instruction at each one
+                std::size_t offset = 0, ip = 0;
+                for (uint16_t j=0; j < count; ++j)
+                {
+                    DebugInfo::Entry entry;
+                    uint16_t entry_offset = readNumber();
+                    entry.file = readNumber();
+                    entry.line = readNumber();
+                    entry.col = readNumber();
+
+                    if (page < m_page_starts.size())
+                    {
+                        while (offset < entry_offset && m_page_starts[page] + offset < m_bytecode.size())
+                        {
+                            std::size_t size = instructionSize(m_bytecode[m_page_starts[page] + offset]);
+                            if (size == 0)
+                                break;
+                            offset += size;
+                            ip += (size == 5) ? 2 : 1;
+                        }
+                    }
+                    entry.ip = ip;
+                    info->locations.back().push_back(entry);
+                }
+            }
+        }
+        catch (const std::out_of_range&)
+        {
+            if (m_debug_level >= 1)
+                Ark::logger.warn("Invalid debug information in the bytecode, ignoring it");
+            info = std::make_unique<DebugInfo>();
+        }
+
+        m_debug_info = std::move(info);
+        return m_debug_info.get();
+    }
+
+    std::optional<SourceLocation> State::sourceLocation(internal::PageAddr_t page, std::size_t ip) const
+    {
+        const DebugInfo* info = debugInfo();
+        if (info == nullptr || page >= info->locations.size())
+            return {};
+
+        // the last location starting at or before the instruction
+        const std::vector<DebugInfo::Entry>& entries = info->locations[page];
+        auto it = std::upper_bound(entries.begin(), entries.end(), ip, [](std::size_t ip, const DebugInfo::Entry& entry) {
+            return ip < entry.ip;
+        });
+        if (it == entries.begin())
+            return {};
+        --it;
+
+        return SourceLocation {
+            it->file < info->files.size() ? info->files[it->file] : "?",
+            it->line,
+            it->col
+        };
+    }
+
+    std::string State::pageName(internal::PageAddr_t page) const
+    {
+        const DebugInfo* info = debugInfo();
+        if (info == nullptr || page >= info->page_names.size())
+            return "";
+        return info->page_names[page];
+    }
 }
\ No newline at end of file
@@ -0,0 +1,66 @@
+#include <Ark/VM/VMPool.hpp>
+
+#include <algorithm>
+
+namespace Ark
+{
+    VMPool::Handle::Handle(VMPool* pool, VM* vm) :
+        m_pool(pool), m_vm(vm)
+    {}
+
+    VMPool::Handle::Handle(Handle&& other) noexcept :
+        m_pool(other.m_pool), m_vm(other.m_vm)
+    {
+        other.m_vm = nullptr;
+    }
+
+    VMPool::Handle::~Handle()
+    {
+        if (m_vm != nullptr)
+            m_pool->release(m_vm);
+    }
+
+    VMPool::VMPool(State* state, std::size_t size) :
+        m_state(state)
+    {
+        // hardware_concurrency can be 0 if it's unknown
+        size = std::max<std::size_t>(size, 1);
+
+        m_state->freeze();
+
+        m_vms.reserve(size);
+        m_available.reserve(size);
+        for (std::size_t i=0; i < size; ++i)
+        {
+            m_vms.push_back(std::make_unique<VM>(m_state));
+            m_available.push_back(m_vms.back().get());
+        }
+    }
+
+    VMPool::Handle VMPool::acquire()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_released.wait(lock, [this] { return !m_available.empty(); });
+
+        VM* vm = m_available.back();
+        m_available.pop_back();
+        return Handle(this, vm);
+    }
+
+    std::size_t VMPool::size() const
+    {
+        return m_vms.size();
+    }
+
+    void VMPool::release(VM* vm)
+    {
+        // the values of the last run are released by the thread which used the VM
+        vm->reset();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_available.push_back(vm);
+        }
+        m_released.notify_one();
+    }
+}
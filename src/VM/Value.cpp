@@ -1,112 +1,266 @@
 #include <Ark/VM/Value.hpp>
 
 #include <Ark/VM/Frame.hpp>
+#include <Ark/VM/Coroutine.hpp>
 #include <Ark/Utils.hpp>
 
 namespace Ark::internal
 {
-    Value::Value()
-    {}
+    thread_local ExecutionContext execution_context;
+
+    Value::Value() :
+        m_bits(0), m_type(ValueType::NFT), m_const(false)
+    {
+        m_nft = NFT::Undefined;
+    }
 
     // --------------------------
 
     Value::Value(ValueType type) :
-        m_type(type), m_const(false)
+        m_bits(0), m_type(type), m_const(false)
     {
-        if (m_type == ValueType::List)
-            m_value = std::vector<Value>();
+        // cell types must always have a valid cell
+        switch (m_type)
+        {
+            case ValueType::List:
+                m_cell = new Cell_t<std::vector<Value>>();
+                break;
+
+            case ValueType::String:
+                m_cell = new Cell_t<std::string>();
+                break;
+
+            case ValueType::CProc:
+                m_cell = new Cell_t<Procedure>();
+                break;
+
+            case ValueType::Closure:
+                m_cell = new Cell_t<Closure>();
+                break;
+
+            case ValueType::User:
+                m_cell = new Cell_t<UserType>(static_cast<void*>(nullptr));
+                break;
+
+            case ValueType::Coroutine:
+                m_cell = new Cell_t<Coroutine>();
+                break;
+
+            default:
+                break;
+        }
     }
 
     Value::Value(int value) :
-        m_value(static_cast<double>(value)), m_type(ValueType::Number), m_const(false)
+        m_integer(static_cast<int64_t>(value)), m_type(ValueType::Number), m_const(false), m_integral(true)
+    {}
+
+    Value::Value(int64_t value) :
+        m_integer(value), m_type(ValueType::Number), m_const(false), m_integral(true)
     {}
 
     Value::Value(float value) :
-        m_value(static_cast<double>(value)), m_type(ValueType::Number), m_const(false)
+        m_number(static_cast<double>(value)), m_type(ValueType::Number), m_const(false)
     {}
 
     Value::Value(double value) :
-        m_value(value), m_type(ValueType::Number), m_const(false)
+        m_number(value), m_type(ValueType::Number), m_const(false)
     {}
 
     Value::Value(const std::string& value) :
-        m_value(value), m_type(ValueType::String), m_const(false)
+        m_cell(new Cell_t<std::string>(value)), m_type(ValueType::String), m_const(false)
     {}
 
     Value::Value(std::string&& value) :
-        m_value(value), m_type(ValueType::String), m_const(false)
+        m_cell(new Cell_t<std::string>(std::move(value))), m_type(ValueType::String), m_const(false)
     {}
 
     Value::Value(PageAddr_t value) :
-        m_value(value), m_type(ValueType::PageAddr), m_const(false)
-    {}
+        m_bits(0), m_type(ValueType::PageAddr), m_const(false)
+    {
+        m_page_addr = value;
+    }
 
     Value::Value(NFT value) :
-        m_value(value), m_type(ValueType::NFT), m_const(false)
-    {}
+        m_bits(0), m_type(ValueType::NFT), m_const(false)
+    {
+        m_nft = value;
+    }
 
     Value::Value(Value::ProcType value) :
-        m_value(value), m_type(ValueType::CProc), m_const(false)
+        m_cell(new Cell_t<Procedure>(Procedure { nullptr, std::move(value) })), m_type(ValueType::CProc), m_const(false)
+    {}
+
+    Value::Value(Value::NativeProcType value) :
+        m_cell(new Cell_t<Procedure>(Procedure { value, nullptr })), m_type(ValueType::CProc), m_const(false)
     {}
 
     Value::Value(std::vector<Value>&& value) :
-        m_value(value), m_type(ValueType::List), m_const(false)
+        m_cell(new Cell_t<std::vector<Value>>(std::move(value))), m_type(ValueType::List), m_const(false)
     {}
 
     Value::Value(Closure&& value) :
-        m_value(value), m_type(ValueType::Closure), m_const(false)
+        m_cell(new Cell_t<Closure>(std::move(value))), m_type(ValueType::Closure), m_const(false)
     {}
 
     Value::Value(UserType&& value) :
-        m_value(value), m_type(ValueType::User), m_const(false)
+        m_cell(new Cell_t<UserType>(std::move(value))), m_type(ValueType::User), m_const(false)
+    {}
+
+    Value::Value(Coroutine&& value) :
+        m_cell(new Cell_t<Coroutine>(std::move(value))), m_type(ValueType::Coroutine), m_const(false)
     {}
 
     // --------------------------
 
-    std::vector<Value>& Value::list()
+    void Value::copyCell()
     {
-        return std::get<std::vector<Value>>(m_value);
+        // every cell is shared, lists included: mutableData detaches them before any modification
+        m_cell->refcount.fetch_add(1, std::memory_order_relaxed);
     }
 
-    Closure& Value::closure_ref()
+    void Value::releaseCell()
     {
-        return std::get<Closure>(m_value);
+        if (m_cell->refcount.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+
+        switch (m_type)
+        {
+            case ValueType::List:
+                delete static_cast<Cell_t<std::vector<Value>>*>(m_cell);
+                break;
+
+            case ValueType::String:
+                delete static_cast<Cell_t<std::string>*>(m_cell);
+                break;
+
+            case ValueType::CProc:
+                delete static_cast<Cell_t<Procedure>*>(m_cell);
+                break;
+
+            case ValueType::Closure:
+                delete static_cast<Cell_t<Closure>*>(m_cell);
+                break;
+
+            case ValueType::User:
+                delete static_cast<Cell_t<UserType>*>(m_cell);
+                break;
+
+            case ValueType::Coroutine:
+                delete static_cast<Cell_t<Coroutine>*>(m_cell);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    template <typename T>
+    T& Value::mutableData()
+    {
+        // copy on write: get our own cell before modifying it
+        if (m_cell->refcount.load(std::memory_order_acquire) != 1)
+        {
+            Cell* cell = new Cell_t<T>(data<T>());
+            releaseCell();
+            m_cell = cell;
+        }
+        return static_cast<Cell_t<T>*>(m_cell)->data;
+    }
+
+    std::vector<Value>& Value::list()
+    {
+        return mutableData<std::vector<Value>>();
     }
 
     std::string& Value::string_ref()
     {
-        return std::get<std::string>(m_value);
+        return mutableData<std::string>();
     }
 
     UserType& Value::usertype_ref()
     {
-        return std::get<UserType>(m_value);
+        return mutableData<UserType>();
     }
 
     // --------------------------
 
     void Value::push_back(const Value& value)
     {
-        m_type = ValueType::List;
-        list().push_back(value);
+        // copied first, so that a list appended to itself is detached instead of containing itself
+        Value copy = value;
+        list().push_back(std::move(copy));
     }
 
     void Value::push_back(Value&& value)
     {
-        m_type = ValueType::List;
-        list().push_back(value);
+        list().push_back(std::move(value));
     }
 
     // --------------------------
 
-    void Value::registerVM(Ark::VM_t<false>* vm)
+    bool Value::cellsEqual(const Value& A, const Value& B)
     {
-        m_vmf = vm;
+        switch (A.m_type)
+        {
+            case ValueType::List:
+                return A.m_cell == B.m_cell || A.const_list() == B.const_list();
+
+            case ValueType::String:
+                return A.m_cell == B.m_cell || A.string() == B.string();
+
+            case ValueType::CProc:
+                return A.m_cell == B.m_cell;
+
+            case ValueType::Closure:
+                return A.closure() == B.closure();
+
+            case ValueType::User:
+                return A.usertype() == B.usertype();
+
+            case ValueType::Coroutine:
+                return A.m_cell == B.m_cell;
+
+            default:
+                return false;
+        }
     }
 
-    void Value::registerVM(Ark::VM_t<true>* vm)
+    bool operator<(const Value& A, const Value& B)
     {
-        m_vmt = vm;
+        if (A.m_type != B.m_type)
+            return (static_cast<int>(A.m_type) - static_cast<int>(B.m_type)) < 0;
+
+        switch (A.m_type)
+        {
+            case ValueType::Number:
+                return lessNumbers(A, B);
+
+            case ValueType::PageAddr:
+                return A.m_page_addr < B.m_page_addr;
+
+            case ValueType::NFT:
+                return A.m_nft < B.m_nft;
+
+            case ValueType::List:
+                return A.const_list() < B.const_list();
+
+            case ValueType::String:
+                return A.string() < B.string();
+
+            case ValueType::CProc:
+                return A.m_cell < B.m_cell;
+
+            case ValueType::Closure:
+                return A.closure() < B.closure();
+
+            case ValueType::User:
+                return A.usertype() < B.usertype();
+
+            case ValueType::Coroutine:
+                return A.m_cell < B.m_cell;
+        }
+        return false;
     }
 
     // --------------------------
@@ -145,6 +299,12 @@ namespace Ark::internal
         {
         case ValueType::Number:
         {
+            if (V.isInteger())
+            {
+                os << V.integer();
+                break;
+            }
+
             double d = V.number();
             os.precision(dig_places(d) + dec_places(d));
             os << d;
@@ -201,6 +361,10 @@ namespace Ark::internal
         case ValueType::User:
             os << V.usertype();
             break;
+
+        case ValueType::Coroutine:
+            os << V.coroutine();
+            break;
         
         default:
             os << "~\\._./~";
@@ -2,6 +2,7 @@
 
 #include <chrono>
 #include <iostream>
+#include <fstream>
 
 #include <clipp.hpp>
 #include <Ark/Ark.hpp>
@@ -17,6 +18,54 @@ void bcr(const std::string& file)
     }
 }
 
+void opcodeStats(const Ark::VM_debug& vm)
+{
+    // useful to choose which sequences of instructions are worth a superinstruction
+    for (std::size_t length=2; length <= 3; ++length)
+    {
+        std::cout << "\nMost executed " << (length == 2 ? "pairs" : "triples") << " of instructions:\n";
+        for (auto&& [opcodes, count] : vm.hottestOpcodeSequences(length, 10))
+        {
+            std::cout << "    " << count << "\t";
+            for (std::size_t i=0; i < opcodes.size(); ++i)
+                std::cout << (i > 0 ? ", " : "") << Ark::internal::instructionName(opcodes[i]);
+            std::cout << "\n";
+        }
+    }
+    std::cout << std::endl;
+}
+
+template <bool debug>
+void gcStats(const Ark::VM_t<debug>& vm)
+{
+    const auto& stats = vm.gcStats();
+    std::cout << "\nCollector:\n"
+              << "    " << stats.minor_collections << " minor collections, " << stats.collections << " full collections in " << stats.time_ms << "ms\n"
+              << "    " << stats.freed_scopes << " freed scopes, " << stats.tracked_scopes << " tracked scopes (threshold: " << stats.threshold << ")\n"
+              << std::endl;
+}
+
+template <bool debug>
+int run(Ark::VM_t<debug>& vm, bool profile, const std::string& samples_file)
+{
+    if (profile)
+        vm.enableProfiler();
+    if (!samples_file.empty())
+        vm.startSampling();
+
+    int out = vm.run();
+
+    if (profile)
+        vm.profileReport(std::cout);
+    if (!samples_file.empty())
+    {
+        vm.stopSampling();
+        std::ofstream samples(samples_file);
+        vm.writeFoldedStacks(samples);
+    }
+    return out;
+}
+
 int main(int argc, char** argv)
 {
     using namespace clipp;
@@ -26,6 +75,10 @@ int main(int argc, char** argv)
 
     std::string file = "", lib_dir = "";
     unsigned debug = 0;
+    bool opcode_stats = false;
+    bool gc_stats = false;
+    bool profile = false;
+    std::string samples_file = "";
     std::vector<std::string> wrong;
     uint16_t options = Ark::DefaultFeatures;
 
@@ -55,6 +108,13 @@ int main(int argc, char** argv)
                     option("-L", "--lib").doc("Set the location of the ArkScript standard library")
                     & value("lib_dir", lib_dir)
                 ),
+                option("--opcode-stats").set(opcode_stats).doc("Display the most executed pairs and triples of instructions after running the program (runs the debug VM)"),
+                option("--gc-stats").set(gc_stats).doc("Display the statistics of the collector after running the program (with -fgc)"),
+                option("--profile").set(profile).doc("Display the calls and time spent in each function, and the executed instructions after running the program"),
+                (
+                    option("--sample").doc("Sample the functions being run every millisecond, and write the samples as folded stacks (for flame graphs) in the given file")
+                    & value("samples_file", samples_file)
+                ),
                 // feature flags
                 with_prefix("-f",
                     // a single feature should always be defined with an ON and an OFF version, and documentation
@@ -64,6 +124,14 @@ int main(int argc, char** argv)
                     | option("no-function-arity-check").call([&]{ options &= ~Ark::FeatureFunctionArityCheck; })
                     ).doc("Toggle function arity checks (default: ON)")
                     ,
+                    ( option("gc"   ).call([&]{ options |= Ark::FeatureGarbageCollector; })
+                    | option("no-gc").call([&]{ options &= ~Ark::FeatureGarbageCollector; })
+                    ).doc("Toggle the collector of the scopes and closures referencing each other (default: OFF)")
+                    ,
+                    ( option("debug-info"   ).call([&]{ options |= Ark::FeatureDebugInfo; })
+                    | option("no-debug-info").call([&]{ options &= ~Ark::FeatureDebugInfo; })
+                    ).doc("Toggle the source locations in the bytecode, used by the error messages and the profiler (default: ON)")
+                    ,
                     ( option("allow-invalid-token-after-paren").call([&]{ options &= ~Ark::FeatureDisallowInvalidTokenAfterParen; })
                     | option("no-invalid-token-after-paren"   ).call([&]{ options |= Ark::FeatureDisallowInvalidTokenAfterParen; })
                     ).doc("Authorize invalid token after `(' (default: OFF). When ON, only display a warning")
@@ -103,7 +171,6 @@ int main(int argc, char** argv)
             case mode::dev_info:
                 std::cout << "Have been compiled with " << ARK_COMPILER << ", options: " << ARK_COMPILATION_OPTIONS << "\n\n";
                 std::cout << "sizeof(Ark::Value)    = " << sizeof(Ark::internal::Value) << "B\n";
-                std::cout << "      sizeof(Value_t) = " << sizeof(Ark::internal::Value::Value_t) << "B\n";
                 std::cout << "sizeof(Ark::Frame)    = " << sizeof(Ark::internal::Frame) << "B\n";
                 std::cout << "sizeof(Ark::State)    = " << sizeof(Ark::State) << "B\n";
                 std::cout << "sizeof(Ark::Plugin)   = " << sizeof(Ark::internal::SharedLibrary) << "B\n";
@@ -146,15 +213,27 @@ int main(int argc, char** argv)
                     return -1;
                 }
 
-                if (debug >= 2)
+                if (debug >= 2 || opcode_stats)
                 {
+                    // only the debug VM counts the instructions, keep it quiet if it wasn't asked for
+                    if (debug < 2)
+                        Ark::logger.setLevel(Ark::LogLevel::Dont);
+
                     Ark::VM_debug vm(&state);
-                    return vm.run();
+                    int out = run(vm, profile, samples_file);
+                    if (opcode_stats)
+                        opcodeStats(vm);
+                    if (gc_stats)
+                        gcStats(vm);
+                    return out;
                 }
                 else
                 {
                     Ark::VM vm(&state);
-                    return vm.run();
+                    int out = run(vm, profile, samples_file);
+                    if (gc_stats)
+                        gcStats(vm);
+                    return out;
                 }
                 break;
             }